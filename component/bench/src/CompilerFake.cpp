@@ -0,0 +1,59 @@
+
+#include "CompilerFake.hpp"
+
+
+namespace bok {
+    CompilerFake::CompilerFake(const std::string &toolPath, const int delayMicroseconds) {
+        this->toolPath = toolPath;
+        this->delayMicroseconds = delayMicroseconds;
+    }
+
+
+    CompileOutput CompilerFake::compile(const std::string &source, const std::string &object) const {
+        const std::string dependencies = object + ".d";
+
+        return CompileOutput {
+            source, 
+            object, 
+            dependencies, 
+            this->createCommand()
+                .addArg("-c")
+                .addArg(source)
+                .addArg("-MF" + dependencies)
+                .addArg("-o")
+                .addArg(object)
+        };
+    }
+
+
+    bool CompilerFake::isCompilable(const std::string &source) const {
+        if (auto pos = source.rfind("."); pos != std::string::npos) {
+            return source.substr(pos) == ".cpp";
+        }
+
+        return false;
+    }
+
+
+    Command CompilerFake::link(const std::string &executable, const std::vector<std::string> &objectFiles) const {
+        Command command = this->createCommand();
+        command.addArg("-o").addArg(executable);
+
+        for (const std::string &objectFile : objectFiles) {
+            command.addArg(objectFile);
+        }
+
+        return command;
+    }
+
+
+    Command CompilerFake::createCommand() const {
+        Command command {toolPath};
+
+        if (delayMicroseconds > 0) {
+            command.addArg("--delay-us").addArg(std::to_string(delayMicroseconds));
+        }
+
+        return command;
+    }
+}
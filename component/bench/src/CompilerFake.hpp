@@ -0,0 +1,38 @@
+
+#pragma once 
+
+#include <bok/core/Compiler.hpp>
+
+
+namespace bok {
+    /**
+     * Compiles through bok-fake-cc, so the scheduler, process and cache overhead of a build can be 
+     * measured without the cost of real compilations.
+     */
+    class CompilerFake : public Compiler {
+    public:
+        explicit CompilerFake(const std::string &toolPath, const int delayMicroseconds = 0);
+
+        virtual ~CompilerFake() {}
+
+        CompileOutput compile(const std::string &source, const std::string &object) const override;
+
+        bool isCompilable(const std::string &source) const override;
+
+        /**
+         * The command linking 'objectFiles' into 'executable', through the same tool.
+         */
+        Command link(const std::string &executable, const std::vector<std::string> &objectFiles) const;
+
+        int getDelay() const {
+            return delayMicroseconds;
+        }
+
+    private:
+        Command createCommand() const;
+
+    private:
+        std::string toolPath;
+        int delayMicroseconds = 0;
+    };
+}
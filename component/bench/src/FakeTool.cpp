@@ -0,0 +1,128 @@
+
+#include "FakeTool.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <bok/core/Hash.hpp>
+
+
+namespace bok {
+    namespace {
+        std::string readFile(const std::string &path) {
+            std::ifstream is {path, std::ios::binary};
+
+            if (! is.is_open()) {
+                throw std::runtime_error("Couldn't open " + path);
+            }
+
+            std::ostringstream content;
+            content << is.rdbuf();
+
+            return content.str();
+        }
+
+
+        void writeFile(const std::string &path, const std::string &content) {
+            std::ofstream os {path, std::ios::binary | std::ios::trunc};
+
+            if (! os.is_open()) {
+                throw std::runtime_error("Couldn't write " + path);
+            }
+
+            os << content;
+        }
+
+
+        void delay(const int microseconds) {
+            if (microseconds > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds{microseconds});
+            }
+        }
+
+
+        /**
+         * Collects the local includes of 'file', recursively, and hashes every file it reads along the way.
+         */
+        void scanIncludes(const std::string &file, std::set<std::string> &includes, std::uint64_t &contentHash) {
+            const std::string content = readFile(file);
+            const std::filesystem::path directory = std::filesystem::path{file}.parent_path();
+
+            contentHash = hashString(content, contentHash);
+
+            std::istringstream lines {content};
+            std::string line;
+
+            while (std::getline(lines, line)) {
+                const std::string directive = "#include \"";
+
+                if (line.compare(0, directive.size(), directive) != 0) {
+                    continue;
+                }
+
+                const std::size_t end = line.find('"', directive.size());
+
+                if (end == std::string::npos) {
+                    continue;
+                }
+
+                const std::string include = (directory / line.substr(directive.size(), end - directive.size())).lexically_normal().string();
+
+                if (includes.insert(include).second) {
+                    scanIncludes(include, includes, contentHash);
+                }
+            }
+        }
+
+
+        std::string escapeMakePath(const std::string &path) {
+            std::string escaped;
+
+            for (const char ch : path) {
+                if (ch == ' ') {
+                    escaped += '\\';
+                }
+
+                escaped += ch;
+            }
+
+            return escaped;
+        }
+    }
+
+
+    void fakeCompile(const std::string &source, const std::string &objectFile, const std::string &dependencyFile, const int delayMicroseconds) {
+        delay(delayMicroseconds);
+
+        std::set<std::string> includes;
+        std::uint64_t contentHash = 0;
+        scanIncludes(source, includes, contentHash);
+
+        std::string dependencies = escapeMakePath(objectFile) + ": " + escapeMakePath(source);
+
+        for (const std::string &include : includes) {
+            dependencies += " \\\n  " + escapeMakePath(include);
+        }
+
+        writeFile(dependencyFile, dependencies + "\n");
+        writeFile(objectFile, "fake object " + std::to_string(contentHash) + "\n");
+    }
+
+
+    void fakeLink(const std::string &executable, const std::vector<std::string> &objectFiles, const int delayMicroseconds) {
+        delay(delayMicroseconds);
+
+        std::uint64_t contentHash = 0;
+
+        for (const std::string &objectFile : objectFiles) {
+            contentHash = hashString(readFile(objectFile), contentHash);
+        }
+
+        writeFile(executable, "fake executable " + std::to_string(contentHash) + "\n");
+    }
+}
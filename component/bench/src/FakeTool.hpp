@@ -0,0 +1,20 @@
+
+#pragma once 
+
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    /**
+     * Stands in for a real compilation: follows the local ("...") includes of 'source' to write 
+     * a make-style depfile, and writes a stub object derived from the contents of every input.
+     * Sleeps 'delayMicroseconds' first, to emulate the compiler's own work.
+     */
+    void fakeCompile(const std::string &source, const std::string &objectFile, const std::string &dependencyFile, const int delayMicroseconds);
+
+    /**
+     * Stands in for a real link, writing a stub executable derived from the objects.
+     */
+    void fakeLink(const std::string &executable, const std::vector<std::string> &objectFiles, const int delayMicroseconds);
+}
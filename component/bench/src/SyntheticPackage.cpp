@@ -0,0 +1,118 @@
+
+#include "SyntheticPackage.hpp"
+
+#include <filesystem>
+#include <set>
+#include <vector>
+
+#include <bok/core/Component.hpp>
+#include <bok/core/FileState.hpp>
+
+
+namespace bok {
+    namespace {
+        std::string makeHeader(const int component, const int header) {
+            const std::string symbol = "c" + std::to_string(component) + "_h" + std::to_string(header);
+
+            return 
+                "#pragma once\n"
+                "\n"
+                "int " + symbol + "(int value);\n";
+        }
+
+
+        std::string makeSource(const SyntheticOptions &options, const int component, const int source, const int dependency) {
+            const int headerCount = options.sourcesPerComponent;
+
+            // a fixed stride spreads the includes over the component, without any randomness
+            std::set<int> headers {source};
+
+            for (int i = 1; i < options.headerFanIn && static_cast<int>(headers.size()) < headerCount; i++) {
+                int header = (source + i * 7919) % headerCount;
+
+                while (headers.count(header)) {
+                    header = (header + 1) % headerCount;
+                }
+
+                headers.insert(header);
+            }
+
+            std::string content;
+
+            for (const int header : headers) {
+                content += "#include \"" + syntheticHeaderName(header) + "\"\n";
+            }
+
+            if (dependency >= 0) {
+                content += "#include \"../" + syntheticComponentName(dependency) + "/" + syntheticHeaderName(0) + "\"\n";
+            }
+
+            const std::string symbol = "c" + std::to_string(component) + "_h" + std::to_string(source);
+
+            content += 
+                "\n"
+                "int " + symbol + "(int value) {\n"
+                "    return value * " + std::to_string(source + 1) + ";\n"
+                "}\n";
+
+            if (source == 0) {
+                content += 
+                    "\n"
+                    "int main() {\n"
+                    "    return " + symbol + "(0);\n"
+                    "}\n";
+            }
+
+            return content;
+        }
+    }
+
+
+    std::string syntheticComponentName(const int component) {
+        return "component" + std::to_string(component);
+    }
+
+
+    std::string syntheticSourceName(const int source) {
+        return "source" + std::to_string(source) + ".cpp";
+    }
+
+
+    std::string syntheticHeaderName(const int header) {
+        return "header" + std::to_string(header) + ".hpp";
+    }
+
+
+    Package* generateSyntheticPackage(const std::string &root, const SyntheticOptions &options) {
+        auto package = new Package("synthetic", root + "/");
+        std::vector<Component*> components;
+
+        for (int component = 0; component < options.componentCount; component++) {
+            const std::string name = syntheticComponentName(component);
+            const int dependency = (component % (options.dependencyDepth + 1) == 0) ? -1 : component - 1;
+
+            std::filesystem::create_directories(root + "/" + name);
+
+            std::vector<std::string> files;
+
+            for (int i = 0; i < options.sourcesPerComponent; i++) {
+                const std::string header = syntheticHeaderName(i);
+                const std::string source = syntheticSourceName(i);
+
+                writeFileIfChanged(root + "/" + name + "/" + header, makeHeader(component, i));
+                writeFileIfChanged(root + "/" + name + "/" + source, makeSource(options, component, i, dependency));
+
+                files.push_back(source);
+                files.push_back(header);
+            }
+
+            components.push_back(package->addComponent(name, name + "/", files));
+
+            if (dependency >= 0) {
+                components.back()->addDependency(components[dependency]);
+            }
+        }
+
+        return package;
+    }
+}
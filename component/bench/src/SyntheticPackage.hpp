@@ -0,0 +1,34 @@
+
+#pragma once 
+
+#include <string>
+
+#include <bok/core/Package.hpp>
+
+
+namespace bok {
+    struct SyntheticOptions {
+        int componentCount = 10;
+        int sourcesPerComponent = 100;
+        int headerFanIn = 4;            // local headers included by each source
+        int dependencyDepth = 2;        // length of the component dependency chains
+    };
+
+
+    /**
+     * Writes a synthetic package under 'root', deterministically for the same options, and returns its model.
+     * 
+     * Every component has a header for each of its sources. Each source includes its own header, 
+     * 'headerFanIn' - 1 others from the same component and the first header of the component it depends on. 
+     * Components form chains of 'dependencyDepth' + 1 links, where each one depends on the previous.
+     * Files whose content is already up to date are left untouched.
+     */
+    Package* generateSyntheticPackage(const std::string &root, const SyntheticOptions &options);
+
+
+    std::string syntheticComponentName(const int component);
+
+    std::string syntheticSourceName(const int source);
+
+    std::string syntheticHeaderName(const int header);
+}
@@ -0,0 +1,242 @@
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <bok/core/BuildCache.hpp>
+#include <bok/core/BuildSystem.hpp>
+#include <bok/core/IncludeScanner.hpp>
+#include <bok/core/JobScheduler.hpp>
+#include <bok/core/Linker.hpp>
+#include <bok/core/Log.hpp>
+#include <bok/core/Package.hpp>
+
+#include "CompilerFake.hpp"
+#include "FakeTool.hpp"
+#include "SyntheticPackage.hpp"
+
+using namespace bok;
+
+
+struct BenchmarkOptions {
+    SyntheticOptions package;
+    std::string root = (std::filesystem::temp_directory_path() / "bok-bench").string();
+    int jobs = 0;
+    int runs = 3;
+    int delay = 0;
+    bool inProcess = false;
+};
+
+
+/**
+ * Runs the commands of the fake compiler, either as processes (like a real build) or in-process,
+ * which leaves only the overhead of bok itself.
+ */
+class BenchmarkListener : public BuildSystem::Listener {
+public:
+    explicit BenchmarkListener(const CompilerFake *compiler, const bool inProcess) {
+        this->compiler = compiler;
+        this->inProcess = inProcess;
+    }
+
+
+    virtual ProcessResult receiveOutput(const CompileOutput &output) override {
+        compileCount++;
+
+        if (inProcess) {
+            fakeCompile(output.sourceFile, output.objectFile, output.dependencyFile, compiler->getDelay());
+            return {};
+        }
+
+        return output.command.execute();
+    }
+
+
+    virtual ProcessResult receiveOutput(const LinkerOutput &output) override {
+        linkCount++;
+
+        if (inProcess) {
+            fakeLink(output.executable, output.objectFiles, compiler->getDelay());
+            return {};
+        }
+
+        return compiler->link(output.executable, output.objectFiles).execute();
+    }
+
+
+    std::size_t getCompileCount() const {
+        return compileCount;
+    }
+
+
+    std::size_t getLinkCount() const {
+        return linkCount;
+    }
+
+private:
+    const CompilerFake *compiler = nullptr;
+    bool inProcess = false;
+    std::atomic<std::size_t> compileCount = 0;
+    std::atomic<std::size_t> linkCount = 0;
+};
+
+
+struct BuildSample {
+    double seconds = 0.0;
+    std::size_t compileCount = 0;
+    std::size_t linkCount = 0;
+};
+
+
+class Benchmark {
+public:
+    explicit Benchmark(const BenchmarkOptions &options)
+        : options(options), compiler(BOK_FAKE_CC_PATH, options.delay) {}
+
+
+    void run() {
+        std::cout << "Generating " << options.package.componentCount << " components with "
+            << options.package.sourcesPerComponent << " sources each in " << options.root << " ..." << std::endl;
+
+        package = generateSyntheticPackage(options.root, options.package);
+
+        this->measure("full build", [this] () {
+            std::remove(this->cacheFile().c_str());
+            std::remove((this->cacheFile() + ".journal").c_str());
+        });
+
+        this->measure("no-op build", [] () {});
+
+        // the cache compares contents, so a touch has to actually change the file
+        this->measure("one source touched", [this] () {
+            this->touch(syntheticComponentName(0) + "/" + syntheticSourceName(options.package.sourcesPerComponent / 2));
+        });
+
+        this->measure("one header touched", [this] () {
+            this->touch(syntheticComponentName(0) + "/" + syntheticHeaderName(0));
+        });
+    }
+
+private:
+    void measure(const std::string &scenario, std::function<void ()> prepare) {
+        std::vector<BuildSample> samples;
+
+        for (int i = 0; i < std::max(options.runs, 1); i++) {
+            prepare();
+            samples.push_back(this->build());
+        }
+
+        std::sort(samples.begin(), samples.end(), [] (const BuildSample &a, const BuildSample &b) {
+            return a.seconds < b.seconds;
+        });
+
+        const BuildSample &median = samples[samples.size() / 2];
+
+        std::printf("%-20s %10.4f s  (min %.4f s)  %8zu compiles  %4zu links\n",
+            scenario.c_str(), median.seconds, samples.front().seconds, median.compileCount, median.linkCount);
+    }
+
+
+    BuildSample build() {
+        BenchmarkListener listener {&compiler, options.inProcess};
+        Linker linker;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        {
+            // loading and compacting the cache are part of every invocation
+            BuildCache buildCache {this->cacheFile()};
+            JobScheduler scheduler {options.jobs};
+            IncludeScanner includeScanner;
+            BuildSystem buildSystem {package, &buildCache, &listener, &scheduler};
+            buildSystem.setIncludeScanner(&includeScanner);
+
+            buildSystem.build(compiler, linker);
+        }
+
+        const auto duration = std::chrono::steady_clock::now() - start;
+
+        return {std::chrono::duration<double>(duration).count(), listener.getCompileCount(), listener.getLinkCount()};
+    }
+
+
+    void touch(const std::string &file) {
+        std::ofstream os {options.root + "/" + file, std::ios::app};
+        os << "// touched " << touchCount++ << "\n";
+    }
+
+
+    std::string cacheFile() const {
+        return options.root + "/buildCache.bin";
+    }
+
+private:
+    BenchmarkOptions options;
+    CompilerFake compiler;
+    Package *package = nullptr;
+    int touchCount = 0;
+};
+
+
+BenchmarkOptions parseBenchmarkOptions(int argc, char **argv) {
+    BenchmarkOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "--in-process") {
+            options.inProcess = true;
+        } else if (i + 1 == argc) {
+            break;
+        } else if (arg == "--components") {
+            options.package.componentCount = std::stoi(argv[++i]);
+        } else if (arg == "--sources") {
+            options.package.sourcesPerComponent = std::stoi(argv[++i]);
+        } else if (arg == "--fan-in") {
+            options.package.headerFanIn = std::stoi(argv[++i]);
+        } else if (arg == "--depth") {
+            options.package.dependencyDepth = std::stoi(argv[++i]);
+        } else if (arg == "--root") {
+            options.root = argv[++i];
+        } else if (arg == "-j") {
+            options.jobs = std::stoi(argv[++i]);
+        } else if (arg == "--runs") {
+            options.runs = std::stoi(argv[++i]);
+        } else if (arg == "--delay-us") {
+            // time each fake compile and link spends, emulating the compiler's own work
+            options.delay = std::stoi(argv[++i]);
+        }
+    }
+
+    return options;
+}
+
+
+/**
+ * Measures the latency of full, no-op and incremental builds of a synthetic package,
+ * compiled with a fake compiler so bok's own overhead can be seen at any scale.
+ */
+int main(int argc, char **argv) {
+    const BenchmarkOptions options = parseBenchmarkOptions(argc, argv);
+
+    // only bok's own work is timed, neither the progress nor the console
+    Log::getDefault().setLevel(LogLevel::Warning);
+
+    try {
+        Benchmark benchmark {options};
+        benchmark.run();
+    } catch (const std::exception &exp) {
+        std::cerr << "Benchmark failed: " << exp.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "FakeTool.hpp"
+
+using namespace bok;
+
+/**
+ * Compiler and linker stand-in for the benchmarks:
+ * 
+ *   bok-fake-cc [--delay-us N] -c <source> -MF<depfile> -o <object>
+ *   bok-fake-cc [--delay-us N] -o <executable> <objects...>
+ */
+int main(int argc, char **argv) {
+    int delay = 0;
+    std::string source;
+    std::string dependencyFile;
+    std::string output;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "--delay-us" && i + 1 < argc) {
+            delay = std::stoi(argv[++i]);
+        } else if (arg == "-c" && i + 1 < argc) {
+            source = argv[++i];
+        } else if (arg.rfind("-MF", 0) == 0) {
+            dependencyFile = arg.substr(3);
+        } else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (output.empty()) {
+        std::cerr << "bok-fake-cc: no output file" << std::endl;
+
+        return 1;
+    }
+
+    try {
+        if (! source.empty()) {
+            fakeCompile(source, output, dependencyFile, delay);
+        } else {
+            fakeLink(output, inputs, delay);
+        }
+    } catch (const std::exception &exp) {
+        std::cerr << "bok-fake-cc: " << exp.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,12 +1,35 @@
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <bok/core/Package.hpp>
+#include <bok/core/Component.hpp>
 #include <bok/core/BuildCache.hpp>
+#include <bok/core/BuildConfiguration.hpp>
+#include <bok/core/BuildServer.hpp>
 #include <bok/core/BuildSystem.hpp>
 #include <bok/core/Compiler.hpp>
 #include <bok/core/CompilerGCC.hpp>
+#include <bok/core/CompileWorker.hpp>
+#include <bok/core/DirectoryCache.hpp>
+#include <bok/core/IncludeScanner.hpp>
+#include <bok/core/JobScheduler.hpp>
+#include <bok/core/ObjectCache.hpp>
 #include <bok/core/Linker.hpp>
+#include <bok/core/Log.hpp>
+#include <bok/core/ResourceBudget.hpp>
+#include <bok/core/Trace.hpp>
+#include <bok/core/WorkerPool.hpp>
+#include <bok/input/ManifestLoader.hpp>
 
 using namespace bok;
 
@@ -47,34 +70,502 @@ Package* createWordCounterPackage() {
 }
 
 
+/**
+ * Reports every action through the log: one line as it starts (and its command, when verbose), 
+ * and the diagnostics of the command as one block when it ends.
+ */
 class BuildCommmandListener : public BuildSystem::Listener {
 public:
-    virtual void receiveOutput(const CompileOutput &output) override {
-        std::cout << "[C++] " << output.sourceFile << " ..." << std::endl;
-        output.command.execute();
+    virtual ProcessResult receiveOutput(const CompileOutput &output) override {
+        log.print(LogLevel::Info, "[C++] ", output.sourceFile, " ...");
+
+        return this->execute(output.command);
     }
 
 
-    virtual void receiveOutput(const LinkerOutput &output) override {
-        std::cout << "[C++] Linking executable ... " << std::endl;
-        output.command.execute();
-        std::cout << "Component path: '" << output.executable << "' ... " << std::endl;
+    virtual void receiveCachedOutput(const CompileOutput &output) override {
+        log.print(LogLevel::Info, "[C++] ", output.sourceFile, " (cached)");
+    }
+
+
+    virtual void receiveRemoteOutput(const CompileOutput &output, const ProcessResult &result) override {
+        log.print(LogLevel::Info, "[C++] ", output.sourceFile, " (worker)");
+
+        this->printResult(result);
+    }
+
+
+    virtual ProcessResult receiveOutput(const LinkerOutput &output) override {
+        log.print(LogLevel::Info, "[C++] Linking ... ");
+
+        ProcessResult result = this->execute(output.command);
+
+        log.print(LogLevel::Info, "Component path: '", output.executable, "' ... ");
+
+        return result;
+    }
+
+    virtual void receiveUnchangedOutput(const LinkerOutput &output) override {
+        log.print(LogLevel::Info, "Component path: '", output.executable, "' (unchanged) ... ");
+    }
+
+private:
+    ProcessResult execute(const Command &command) {
+        if (log.isEnabled(LogLevel::Verbose)) {
+            log.print(LogLevel::Verbose, command.toString());
+        }
+
+        try {
+            ProcessResult result = command.execute();
+            this->printResult(result);
+
+            return result;
+        } catch (const CommandError &error) {
+            this->printResult(error.getResult());
+            throw;
+        }
     }
+
+
+    void printResult(const ProcessResult &result) {
+        if (! result.standardOutput.empty()) {
+            log.write(LogLevel::Info, result.standardOutput);
+        }
+
+        if (! result.standardError.empty()) {
+            log.write(LogLevel::Warning, result.standardError);
+        }
+    }
+
+private:
+    Log &log = Log::getDefault();
+};
+
+
+struct BuildOptions {
+    int jobs = 0;
+    bool keepGoing = false;
+    bool precompiledHeaders = false;
+    bool unityBuild = false;
+    bool splitDwarf = false;
+    std::string linkerFlavor;
+    std::string objectCacheDirectory;
+    std::uint64_t objectCacheSize = ObjectCache::DEFAULT_MAX_SIZE;
+    std::string traceFile;
+    std::string metricsFile;
+    bool watch = false;
+    bool stopServer = false;
+    bool noServer = false;
+    std::string packageDirectory;
+    std::string configuration = "debug";
+    std::vector<std::string> compileFlags;
+    std::vector<std::string> linkFlags;
+    std::string buildDirectory;
+    bool worker = false;
+    std::string workerEndpoint = "unix:compileWorker.sock";
+    std::vector<std::string> workers;
+    int workerTimeout = 60;
+    LogLevel logLevel = LogLevel::Info;
+    std::uint64_t memoryBudget = 0;
+    std::size_t linkJobs = 0;
+    bool report = false;
+    std::size_t reportCount = 20;
 };
 
 
+// where 'bok watch' listens for the build requests of a configuration
+std::string buildServerSocket(const BuildConfiguration &configuration) {
+    return "buildServer." + configuration.getName() + ".sock";
+}
+
+// the parsed manifests of the last '--package' build
+const std::string MANIFEST_CACHE = "manifestCache.bin";
+
+
+BuildOptions parseBuildOptions(int argc, char **argv) {
+    BuildOptions options;
+
+    if (const char *directory = std::getenv("BOK_OBJECT_CACHE")) {
+        options.objectCacheDirectory = directory;
+    }
+
+    if (const char *workers = std::getenv("BOK_WORKERS")) {
+        // separated by commas
+        std::stringstream ss {workers};
+        std::string endpoint;
+
+        while (std::getline(ss, endpoint, ',')) {
+            if (! endpoint.empty()) {
+                options.workers.push_back(endpoint);
+            }
+        }
+    }
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "-j" && i + 1 < argc) {
+            options.jobs = std::stoi(argv[++i]);
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+            options.jobs = std::stoi(arg.substr(2));
+        } else if (arg == "-k" || arg == "--keep-going") {
+            options.keepGoing = true;
+        } else if (arg == "--pch") {
+            options.precompiledHeaders = true;
+        } else if (arg == "--unity") {
+            options.unityBuild = true;
+        } else if (arg == "--split-dwarf") {
+            options.splitDwarf = true;
+        } else if (arg.rfind("--linker=", 0) == 0) {
+            // "fast" picks the fastest one installed
+            options.linkerFlavor = arg.substr(9);
+        } else if (arg == "--object-cache" && i + 1 < argc) {
+            options.objectCacheDirectory = argv[++i];
+        } else if (arg == "--object-cache-size" && i + 1 < argc) {
+            // in megabytes
+            options.objectCacheSize = std::stoull(argv[++i]) * 1024 * 1024;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            options.traceFile = argv[++i];
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            options.metricsFile = argv[++i];
+        } else if (arg == "watch" && i == 1) {
+            options.watch = true;
+        } else if (arg == "worker" && i == 1) {
+            options.worker = true;
+        } else if (arg == "report" && i == 1) {
+            options.report = true;
+        } else if (arg == "--top" && i + 1 < argc) {
+            options.reportCount = std::stoul(argv[++i]);
+        } else if (arg == "--listen" && i + 1 < argc) {
+            options.workerEndpoint = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            options.workers.push_back(argv[++i]);
+        } else if (arg == "--worker-timeout" && i + 1 < argc) {
+            // in seconds
+            options.workerTimeout = std::stoi(argv[++i]);
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            // in megabytes; by default, the cgroup limit or the physical memory
+            options.memoryBudget = std::stoull(argv[++i]) * 1024 * 1024;
+        } else if (arg == "--link-jobs" && i + 1 < argc) {
+            options.linkJobs = std::stoul(argv[++i]);
+        } else if (arg == "-v" || arg == "--verbose") {
+            // prints every command
+            options.logLevel = LogLevel::Verbose;
+        } else if (arg == "--debug") {
+            // also prints why each action is out of date
+            options.logLevel = LogLevel::Debug;
+        } else if (arg == "-q" || arg == "--quiet") {
+            options.logLevel = LogLevel::Warning;
+        } else if (arg == "--stop") {
+            options.stopServer = true;
+        } else if (arg == "--no-server") {
+            options.noServer = true;
+        } else if (arg == "--package" && i + 1 < argc) {
+            options.packageDirectory = argv[++i];
+        } else if (arg == "--config" && i + 1 < argc) {
+            options.configuration = argv[++i];
+        } else if (arg == "--flag" && i + 1 < argc) {
+            options.compileFlags.push_back(argv[++i]);
+        } else if (arg == "--link-flag" && i + 1 < argc) {
+            options.linkFlags.push_back(argv[++i]);
+        } else if (arg == "--build-dir" && i + 1 < argc) {
+            // like a tmpfs mount; every configuration gets a directory of its own in there
+            options.buildDirectory = argv[++i];
+        }
+    }
+
+    return options;
+}
+
+
+/**
+ * One of the predefined configurations, or a custom one made of just the given flags.
+ */
+BuildConfiguration createBuildConfiguration(const BuildOptions &options) {
+    BuildConfiguration configuration = options.compileFlags.empty() || BuildConfiguration::isPredefined(options.configuration)
+        ? BuildConfiguration::fromName(options.configuration) 
+        : BuildConfiguration{options.configuration, ".bok/" + options.configuration, {}};
+
+    for (const std::string &flag : options.compileFlags) {
+        configuration.addCompileFlag(flag);
+    }
+
+    for (const std::string &flag : options.linkFlags) {
+        configuration.addLinkFlag(flag);
+    }
+
+    if (! options.buildDirectory.empty()) {
+        configuration.setOutputDirectory((std::filesystem::absolute(options.buildDirectory) / options.configuration).string());
+    }
+
+    return configuration;
+}
+
+
+void writeTraceFiles(const BuildOptions &options) {
+    Trace &trace = Trace::getDefault();
+    Log &log = Log::getDefault();
+
+    trace.setMetric("log.dropped", static_cast<double>(log.getDroppedCount()));
+
+    if (! options.traceFile.empty() && !trace.writeChromeTrace(options.traceFile)) {
+        log.print(LogLevel::Error, "Couldn't write the trace file ", options.traceFile);
+    }
+
+    if (! options.metricsFile.empty() && !trace.writeMetrics(options.metricsFile)) {
+        log.print(LogLevel::Error, "Couldn't write the metrics file ", options.metricsFile);
+    }
+}
+
+
+/**
+ * Lists the slowest actions of the last build, and how their duration compares to the builds before.
+ */
+void printReport(const BuildCache &buildCache, const std::size_t count) {
+    using History = std::pair<std::string, BuildCache::ActionHistory>;
+
+    std::vector<History> histories;
+
+    for (auto &pair : buildCache.getHistories()) {
+        if (! pair.second.durations.empty()) {
+            histories.push_back(std::move(pair));
+        }
+    }
+
+    std::sort(histories.begin(), histories.end(), [] (const History &a, const History &b) {
+        return a.second.durations.front() > b.second.durations.front();
+    });
+
+    histories.resize(std::min(histories.size(), count));
+
+    Log &log = Log::getDefault();
+    log.print(LogLevel::Info, "      last    median   trend   peak RSS  file");
+
+    for (const auto &[file, history] : histories) {
+        std::vector<std::chrono::microseconds> durations = history.durations;
+        const double last = std::chrono::duration<double>(durations.front()).count();
+
+        std::nth_element(durations.begin(), durations.begin() + durations.size() / 2, durations.end());
+        const double median = std::chrono::duration<double>(durations[durations.size() / 2]).count();
+
+        // against the builds before the last one
+        std::string trend = "new";
+
+        if (history.durations.size() > 1) {
+            std::vector<std::chrono::microseconds> previous {history.durations.begin() + 1, history.durations.end()};
+            std::nth_element(previous.begin(), previous.begin() + previous.size() / 2, previous.end());
+
+            const double before = std::chrono::duration<double>(previous[previous.size() / 2]).count();
+            char percent[16];
+            std::snprintf(percent, sizeof(percent), "%+.0f%%", before > 0.0 ? (last - before) / before * 100.0 : 0.0);
+            trend = percent;
+        }
+
+        char line[64];
+        std::snprintf(line, sizeof(line), "%9.2fs %8.2fs %7s %7.0f MB  ", last, median, trend.c_str(), static_cast<double>(history.usage.peakMemory) / (1024 * 1024));
+
+        log.print(LogLevel::Info, line, file);
+    }
+}
+
+
+/**
+ * 'bok watch' keeps serving builds (see BuildServer), until 'bok watch --stop'. While it runs, a plain 'bok' 
+ * asks it for the build, with the options the server was started with, unless '--no-server' is given.
+ * There's a server per build configuration ('--config').
+ *
+ * Every configuration is built into '.bok/<configuration>' within the package, or into the '--build-dir' given.
+ *
+ * 'bok worker --listen <endpoint>' compiles for other builds, which use it with '--worker <endpoint>' (see WorkerPool).
+ *
+ * 'bok report' lists the slowest actions of the last builds of a configuration ('--top <count>' of them).
+ *
+ * Up to '-j' actions run at once, as long as the memory they took last time fits in '--memory-budget' (see ResourceBudget).
+ */
 int main(int argc, char **argv) {
+    BuildOptions options = parseBuildOptions(argc, argv);
+
+    Log &log = Log::getDefault();
+    log.setLevel(options.logLevel);
+
+    if (options.worker) {
+        try {
+            CompileWorker worker {WorkerEndpoint::parse(options.workerEndpoint), options.jobs};
+            worker.run();
+        } catch (const std::exception &exp) {
+            log.print(LogLevel::Error, exp.what());
+
+            return 1;
+        }
+
+        return 0;
+    }
+    std::optional<BuildConfiguration> configuration;
+
+    try {
+        configuration = createBuildConfiguration(options);
+    } catch (const std::exception &exp) {
+        log.print(LogLevel::Error, exp.what());
+
+        return 1;
+    }
+
+    const std::string serverSocket = buildServerSocket(*configuration);
+
+    if (options.watch && options.stopServer) {
+        if (! BuildServer::requestStop(serverSocket)) {
+            log.print(LogLevel::Error, "There's no build server running");
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (! options.watch && !options.noServer && !options.report) {
+        if (const auto status = BuildServer::requestBuild(serverSocket, std::cout)) {
+            return *status;
+        }
+    }
+
+    if (! options.traceFile.empty()) {
+        Trace::getDefault().enable();
+    }
+
     CompilerGCC compiler;
+    compiler.setSplitDwarf(options.splitDwarf);
+    compiler.setFlags(configuration->getCompileFlags());
+
     Linker linker;
-    BuildCache buildCache{"buildCache.txt"};
+    linker.setLinkerFlavor(options.linkerFlavor == "fast" ? Linker::findFastLinker() : options.linkerFlavor);
+    linker.setFlags(configuration->getLinkFlags());
+
+    Package *package = nullptr;
 
-    // Package *package = createHelloWorldPackage();
-    Package *package = createWordCounterPackage();
+    if (options.packageDirectory.empty()) {
+        // Package *package = createHelloWorldPackage();
+        package = createWordCounterPackage();
+    } else {
+        try {
+            input::ManifestLoader manifestLoader {MANIFEST_CACHE};
+            package = input::createPackage(options.packageDirectory, manifestLoader.load(options.packageDirectory));
+        } catch (const std::exception &exp) {
+            log.print(LogLevel::Error, exp.what());
+
+            return 1;
+        }
+    }
+
+    // each configuration keeps its own build cache, within its output directory
+    const std::string outputDirectory = configuration->resolveOutputDirectory(package->getPath());
+    std::filesystem::create_directories(outputDirectory);
+
+    BuildCache buildCache{outputDirectory + "/buildCache.bin"};
+
+    if (options.report) {
+        printReport(buildCache, options.reportCount);
+
+        return 0;
+    }
+
+    if (options.precompiledHeaders) {
+        for (Component *component : package->getComponents()) {
+            component->setAutomaticPrefixHeader(true);
+        }
+    }
     
+    std::unique_ptr<WorkerPool> workerPool;
+
+    if (! options.workers.empty()) {
+        std::vector<WorkerEndpoint> endpoints;
+
+        try {
+            for (const std::string &endpoint : options.workers) {
+                endpoints.push_back(WorkerEndpoint::parse(endpoint));
+            }
+        } catch (const std::exception &exp) {
+            log.print(LogLevel::Error, exp.what());
+
+            return 1;
+        }
+
+        workerPool = std::make_unique<WorkerPool>(endpoints, &compiler);
+        workerPool->setTimeout(std::chrono::seconds{options.workerTimeout});
+        const std::size_t workerJobs = workerPool->probe();
+
+        // enough jobs to keep both this machine and the workers busy
+        if (options.jobs == 0) {
+            options.jobs = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()) + workerJobs);
+        }
+    }
+
     BuildCommmandListener listener;
-    BuildSystem buildSystem {package, &buildCache, &listener};
+    JobScheduler scheduler {options.jobs, options.keepGoing};
+    ResourceBudget resourceBudget {options.memoryBudget, options.linkJobs};
+    BuildSystem buildSystem {package, &buildCache, &listener, &scheduler};
+
+    buildSystem.setConfiguration(*configuration);
+    buildSystem.setWorkerPool(workerPool.get());
+    buildSystem.setUnityBuild(options.unityBuild);
+    buildSystem.setResourceBudget(&resourceBudget);
+
+    DirectoryCache directoryCache {"directoryCache.bin"};
+    buildSystem.setDirectoryCache(&directoryCache);
+
+    IncludeScanner includeScanner;
+    buildSystem.setIncludeScanner(&includeScanner);
+
+    std::unique_ptr<ObjectCache> objectCache;
+
+    if (! options.objectCacheDirectory.empty()) {
+        objectCache = std::make_unique<ObjectCache>(options.objectCacheDirectory, options.objectCacheSize);
+        buildSystem.setObjectCache(objectCache.get());
+    }
+
+    if (options.watch) {
+        auto build = [&] (std::ostream &output) {
+            // the server's own builds go to the standard streams
+            log.redirect(&output == &std::cout ? nullptr : &output);
+
+            bool succeeded = true;
+
+            try {
+                buildSystem.build(compiler, linker);
+            } catch (const std::exception &exp) {
+                log.print(LogLevel::Error, "Build failed: ", exp.what());
+                succeeded = false;
+            }
+
+            buildCache.commit();
+            log.redirect(nullptr);
+
+            return succeeded;
+        };
+
+        try {
+            BuildServer server {serverSocket, &buildCache, build};
+            server.run();
+        } catch (const std::exception &exp) {
+            log.print(LogLevel::Error, exp.what());
+
+            return 1;
+        }
+
+        return 0;
+    }
+
+    try {
+        buildSystem.build(compiler, linker);
+    } catch (const std::exception &exp) {
+        log.print(LogLevel::Error, "Build failed: ", exp.what());
+        buildCache.compact();
+        writeTraceFiles(options);
+
+        return 1;
+    }
 
-    buildSystem.build(compiler, linker);
+    // now rather than on destruction, so the trace shows it
+    buildCache.compact();
+    writeTraceFiles(options);
 
     return 0;
 }
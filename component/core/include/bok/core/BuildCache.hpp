@@ -1,42 +1,203 @@
 
 #pragma once 
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <string>
 #include <optional>
-#include <map>
-#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+
+#include "Command.hpp"
+#include "FileState.hpp"
+#include "FileStateSnapshot.hpp"
 
 
 namespace bok {
+    /**
+     * Persistent record of what has been built. 
+     * 
+     * The cache lives in two files: a binary snapshot ('cacheFile'), sorted by path and memory mapped as-is 
+     * at startup, and an append-only journal ('cacheFile' + ".journal") that receives the entries recorded 
+     * during a build, in batches. On destruction both are compacted into a new snapshot, which atomically 
+     * replaces the previous one, so an interrupted build loses at most the last uncommitted batch.
+     */
+    class JobScheduler;
+
     class BuildCache {
-    private:
-        enum DATA_LOCATION {
-            DL_CACHE,
-            DL_FILESYSTEM
+    public:
+        // how many builds of each file are remembered
+        static constexpr std::size_t DURATION_HISTORY = 8;
+
+        /**
+         * What the builds of a file took.
+         */
+        struct ActionHistory {
+            ResourceUsage usage;                                    // of the last build that ran locally
+            std::vector<std::chrono::microseconds> durations;       // of the last builds, most recent first
         };
 
+    private:
+        /**
+         * State of a built file (a source, or the output of a link) and of everything it was built from.
+         */
+        struct CacheEntry {
+            FileState state;
+            std::uint64_t commandHash = 0;
+            ResourceUsage usage;
+            std::array<std::uint32_t, DURATION_HISTORY> durations {};      // in microseconds, 0 for none
+            std::vector<std::pair<std::string, FileState>> dependencies;
+        };
 
     public:
         explicit BuildCache(const std::string &cacheFile);
 
         ~BuildCache();
 
-        void sourceBuilt(const std::string &sourceFile);
+        BuildCache(const BuildCache &) = delete;
+
+        BuildCache& operator= (const BuildCache &) = delete;
+
+        /**
+         * Records a successful build of 'sourceFile' with 'commandLine', along with the files it depends on 
+         * (usually the prerequisites listed in the depfile emitted by the compiler), and the resources the 
+         * compile took. The parts of 'usage' that are unknown keep the ones recorded by a previous build, 
+         * and its wall time is added to the duration history.
+         */
+        void sourceBuilt(const std::string &sourceFile, const std::string &commandLine, const std::vector<std::string> &dependencies = {}, const ResourceUsage &usage = {});
+
+        /**
+         * A source needs to be rebuilt when its command line (and so its flags) changed, or when the content 
+         * of itself, or of any of its recorded dependencies, changed since its last build. Files whose stat 
+         * information changed but whose content didn't get their cache entry refreshed instead.
+         */
+        bool sourceNeedsRebuild(const std::string &sourceFile, const std::string &commandLine);
+
+        /**
+         * Records a successful link of 'outputFile', from 'inputs' with 'commandLine', like sourceBuilt.
+         */
+        void linkBuilt(const std::string &outputFile, const std::string &commandLine, const std::vector<std::string> &inputs, const ResourceUsage &usage = {});
+
+        /**
+         * A link needs to be redone when its output changed or is gone, when its command line changed, 
+         * or when its set of inputs, or the content of any of them, changed.
+         */
+        bool linkNeedsRebuild(const std::string &outputFile, const std::string &commandLine, const std::vector<std::string> &inputs);
+
+        /**
+         * The resources the last build of 'file' (a source, or the output of a link) took, if known.
+         */
+        std::optional<ResourceUsage> getResourceUsage(const std::string &file) const;
+
+        /**
+         * What the builds of 'file' took, if it was ever built.
+         */
+        std::optional<ActionHistory> getHistory(const std::string &file) const;
+
+        /**
+         * The history of every file in the cache.
+         */
+        std::map<std::string, ActionHistory> getHistories() const;
+
+        /**
+         * Writes the pending journal entries.
+         */
+        void commit();
+
+        /**
+         * Starts a new file-state snapshot for the next build, unless the file states are resident.
+         */
+        void startBuild();
 
-        bool sourceNeedsRebuild(const std::string &sourceFile) const;
+        /**
+         * Stats 'files', and the recorded dependencies of each one, in parallel and ahead of checking them.
+         */
+        void prefetchFileStates(const std::vector<std::string> &files, JobScheduler *scheduler);
+
+        /**
+         * Reports that the build wrote 'file' (like an object file), so its state is stated again.
+         */
+        void fileWritten(const std::string &file);
+
+        /**
+         * The state of the files checked so far in this build.
+         */
+        FileStateSnapshot& getFileStates() {
+            return fileStates;
+        }
+
+        /**
+         * Keeps the file-state snapshot from one build to the next, so checking a file again doesn't 
+         * touch the file system. Meant for long-running processes that learn about changes by other 
+         * means (like inotify), and report them through refreshFileStates.
+         */
+        void setResidentFileStates(const bool resident);
+
+        /**
+         * Stats 'files' again, replacing their resident state. Returns the ones whose state changed.
+         */
+        std::vector<std::string> refreshFileStates(const std::vector<std::string> &files);
+
+        /**
+         * Drops every resident state, so each file gets checked against the file system again.
+         */
+        void forgetFileStates();
+
+        /**
+         * The files with a resident state, that is, every file the cache relies on.
+         */
+        std::vector<std::string> getResidentFiles() const;
+
+        /**
+         * Merges the snapshot and the journal into a new snapshot.
+         */
+        void compact();
 
     private:
         void loadCache();
 
-        void saveCache();
+        void mapSnapshot();
+
+        void unmapSnapshot();
+
+        void replayJournal();
+
+        std::optional<CacheEntry> findSnapshotEntry(const std::string &sourceFile, const bool withDependencies = true) const;
 
-        void appendEntryToCache(const std::string &sourceFile, const time_t modifiedTime);
+        static ActionHistory toHistory(const CacheEntry &entry);
 
-        std::optional<time_t> getModifiedTime(const char *fileName, DATA_LOCATION location) const;
+        void recordEntry(const std::string &file, const std::uint64_t commandHash, const std::vector<std::string> &dependencies, const ResourceUsage &usage);
+
+        bool entryNeedsRebuild(const std::string &file, const std::uint64_t commandHash, const std::vector<std::string> *inputs);
+
+        void appendEntryToCache(const std::string &sourceFile, const CacheEntry &entry);
+
+        void commit(const bool force);
+
+        bool fileChanged(const std::string &fileName, FileState &recordedState, bool &refreshed);
 
     private:
         std::string cacheFile;
-        std::map<std::string, time_t> sourceCache;
-        std::fstream fsOutput;
+        std::string journalFile;
+
+        const char *snapshotData = nullptr;
+        std::size_t snapshotSize = 0;
+
+        // entries recorded or refreshed since the snapshot was written
+        std::unordered_map<std::string, CacheEntry> sourceCache;
+
+        int journalFd = -1;
+        std::string pendingJournal;
+        std::chrono::steady_clock::time_point lastCommit;
+
+        bool residentFileStates = false;
+        FileStateSnapshot fileStates;
+
+        mutable std::mutex mutex;
+        std::mutex commitMutex;
     };
 }
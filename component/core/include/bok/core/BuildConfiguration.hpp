@@ -0,0 +1,79 @@
+
+#pragma once 
+
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    /**
+     * A named set of flags (like "debug" or "release"), built into its own output directory. Every 
+     * configuration keeps its objects, executables, generated sources and build cache apart from the 
+     * others, so switching between them doesn't rebuild anything that was built before.
+     */
+    class BuildConfiguration {
+    public:
+        /**
+         * The "debug" configuration, which leaves the objects next to their sources.
+         */
+        BuildConfiguration();
+
+        /**
+         * A custom configuration, built into 'outputDirectory' (relative to the package unless absolute).
+         */
+        BuildConfiguration(const std::string &name, const std::string &outputDirectory, const std::vector<std::string> &compileFlags, const std::vector<std::string> &linkFlags = {});
+
+        /**
+         * One of the predefined configurations: "debug", "release", "relwithdebinfo" or "minsizerel", 
+         * built into ".bok/<name>".
+         */
+        static BuildConfiguration fromName(const std::string &name);
+
+        static bool isPredefined(const std::string &name);
+
+        BuildConfiguration& addCompileFlag(const std::string &flag) {
+            compileFlags.push_back(flag);
+
+            return *this;
+        }
+
+        BuildConfiguration& addLinkFlag(const std::string &flag) {
+            linkFlags.push_back(flag);
+
+            return *this;
+        }
+
+        BuildConfiguration& setOutputDirectory(const std::string &outputDirectory) {
+            this->outputDirectory = outputDirectory;
+
+            return *this;
+        }
+
+        std::string getName() const {
+            return name;
+        }
+
+        std::string getOutputDirectory() const {
+            return outputDirectory;
+        }
+
+        /**
+         * The output directory of a package in 'packagePath'. Empty when the outputs go next to the sources.
+         */
+        std::string resolveOutputDirectory(const std::string &packagePath) const;
+
+        const std::vector<std::string>& getCompileFlags() const {
+            return compileFlags;
+        }
+
+        const std::vector<std::string>& getLinkFlags() const {
+            return linkFlags;
+        }
+
+    private:
+        std::string name;
+        std::string outputDirectory;
+        std::vector<std::string> compileFlags;
+        std::vector<std::string> linkFlags;
+    };
+}
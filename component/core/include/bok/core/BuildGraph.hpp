@@ -0,0 +1,184 @@
+
+#pragma once 
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Compiler.hpp"
+#include "Linker.hpp"
+#include "PathTable.hpp"
+
+
+namespace bok {
+    class Component;
+
+    using ActionId = std::uint32_t;
+
+    /**
+     * A contiguous run of ids, stored within the graph.
+     */
+    template<typename Id>
+    class IdRange {
+    public:
+        IdRange(const Id *first, const Id *last) 
+            : first(first), last(last) {}
+
+        const Id* begin() const {
+            return first;
+        }
+
+        const Id* end() const {
+            return last;
+        }
+
+        std::size_t size() const {
+            return static_cast<std::size_t>(last - first);
+        }
+
+    private:
+        const Id *first;
+        const Id *last;
+    };
+
+
+    /**
+     * Directed acyclic graph of the compile and link actions of a build. An action can run as soon as 
+     * every action it depends on has finished successfully.
+     * 
+     * Actions are identified by their index, and kept as a structure of arrays. The files each action reads 
+     * and writes are interned in a PathTable, so a link depends on the compiles producing its objects 
+     * without comparing any string. Edges are packed together by computeCriticalPaths().
+     */
+    class BuildGraph {
+    public:
+        enum class ActionType : std::uint8_t {
+            Compile,
+            Link
+        };
+
+    public:
+        /**
+         * Adds the compile of 'output', whose cost is relative to that of a regular compile.
+         */
+        ActionId addCompile(const Component *component, CompileOutput output, const double cost = 1.0);
+
+        /**
+         * Adds the link of 'output'. It depends on the actions already added that produce its objects, 
+         * or its dependencies.
+         */
+        ActionId addLink(const Component *component, LinkerOutput output, const double cost = 1.0);
+
+        /**
+         * Makes 'dependent' wait for 'dependency'.
+         */
+        void addEdge(const ActionId dependency, const ActionId dependent);
+
+        /**
+         * Packs the edges and computes the critical path of every action. Throws when the graph has a cycle.
+         */
+        void computeCriticalPaths();
+
+        std::size_t getActionCount() const {
+            return types.size();
+        }
+
+        ActionType getType(const ActionId action) const {
+            return types[action];
+        }
+
+        const Component* getComponent(const ActionId action) const {
+            return components[action];
+        }
+
+        const CompileOutput& getCompileOutput(const ActionId action) const {
+            return compileOutputs[payloads[action]];
+        }
+
+        const LinkerOutput& getLinkerOutput(const ActionId action) const {
+            return linkerOutputs[payloads[action]];
+        }
+
+        double getCost(const ActionId action) const {
+            return costs[action];
+        }
+
+        /**
+         * Replaces the estimated cost of 'action' (like with the time it took last time). 
+         * Only has an effect before computeCriticalPaths().
+         */
+        void setCost(const ActionId action, const double cost) {
+            costs[action] = cost;
+        }
+
+        /**
+         * The estimated cost of the longest chain of actions starting from 'action'.
+         */
+        double getCriticalPath(const ActionId action) const {
+            return criticalPaths[action];
+        }
+
+        std::uint32_t getDependencyCount(const ActionId action) const {
+            return dependencyCounts[action];
+        }
+
+        /**
+         * The actions waiting for 'action'. Only available after computeCriticalPaths().
+         */
+        IdRange<ActionId> getDependents(const ActionId action) const {
+            return {dependentIds.data() + dependentOffsets[action], dependentIds.data() + dependentOffsets[action + 1]};
+        }
+
+        PathId getOutput(const ActionId action) const {
+            return outputs[action];
+        }
+
+        IdRange<PathId> getInputs(const ActionId action) const {
+            return {inputs.data() + inputOffsets[action], inputs.data() + inputOffsets[action + 1]};
+        }
+
+        /**
+         * The action writing 'path', if any.
+         */
+        std::optional<ActionId> findProducer(std::string_view path) const;
+
+        const PathTable& getPaths() const {
+            return paths;
+        }
+
+    private:
+        ActionId addAction(const ActionType type, const Component *component, const std::uint32_t payload, const double cost, std::string_view output);
+
+        void addInput(std::string_view path);
+
+    private:
+        static constexpr ActionId NO_ACTION = std::numeric_limits<ActionId>::max();
+
+        PathTable paths;
+
+        // one element per action
+        std::vector<ActionType> types;
+        std::vector<const Component*> components;
+        std::vector<std::uint32_t> payloads;         // index into compileOutputs or linkerOutputs
+        std::vector<double> costs;
+        std::vector<double> criticalPaths;
+        std::vector<std::uint32_t> dependencyCounts;
+        std::vector<PathId> outputs;
+        std::vector<std::uint32_t> inputOffsets = {0};
+        std::vector<std::uint32_t> dependentOffsets;
+
+        std::vector<PathId> inputs;
+        std::vector<ActionId> dependentIds;
+        std::vector<std::pair<ActionId, ActionId>> edges;
+
+        // by path id
+        std::vector<ActionId> producers;
+
+        std::vector<CompileOutput> compileOutputs;
+        std::vector<LinkerOutput> linkerOutputs;
+    };
+}
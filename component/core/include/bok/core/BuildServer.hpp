@@ -0,0 +1,84 @@
+
+#pragma once 
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+
+#include "FileWatcher.hpp"
+
+
+namespace bok {
+    class BuildCache;
+
+    /**
+     * Keeps a build resident between builds: the package, the build cache and the state of every file 
+     * it depends on stay in memory, and inotify reports which files changed. A build starts on its own 
+     * once the changes settle down, and clients connected to a Unix socket can request one, which 
+     * then only has to check the files that changed. Files that can't be watched (like past the inotify
+     * watch limit) are stated again before every requested build.
+     */
+    class BuildServer {
+    public:
+        /**
+         * Runs a build, writing its output to 'output'. Returns whether it succeeded.
+         */
+        using BuildFunction = std::function<bool (std::ostream &output)>;
+
+    public:
+        explicit BuildServer(const std::string &socketPath, BuildCache *buildCache, BuildFunction buildFunction);
+
+        ~BuildServer();
+
+        BuildServer(const BuildServer &) = delete;
+
+        BuildServer& operator= (const BuildServer &) = delete;
+
+        /**
+         * How long the files have to stay unchanged before starting a build on its own.
+         */
+        void setDebounce(const std::chrono::milliseconds debounce) {
+            this->debounce = debounce;
+        }
+
+        /**
+         * Serves until it's interrupted (SIGINT or SIGTERM), or a client asks it to stop.
+         */
+        void run();
+
+        /**
+         * Asks the server listening on 'socketPath' for a build, and copies its output to 'output'. 
+         * Returns the exit status of the build, or nothing when there's no server listening.
+         */
+        static std::optional<int> requestBuild(const std::string &socketPath, std::ostream &output);
+
+        /**
+         * Asks the server listening on 'socketPath' to stop. Returns false when there's no server listening.
+         */
+        static bool requestStop(const std::string &socketPath);
+
+    private:
+        bool build(std::ostream &output);
+
+        void watchResidentFiles();
+
+        bool processChanges();
+
+        bool serveClient(const int clientFd);
+
+    private:
+        std::string socketPath;
+        BuildCache *buildCache = nullptr;
+        BuildFunction buildFunction;
+        std::chrono::milliseconds debounce {100};
+
+        FileWatcher watcher;
+        std::set<std::string> polledFiles;      // resident, but couldn't be watched
+        bool watchLimitReported = false;
+        int listenFd = -1;
+        bool changesPending = false;
+    };
+}
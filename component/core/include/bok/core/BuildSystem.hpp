@@ -2,38 +2,189 @@
 #ifndef __BOK_BUILDSYSTEM_HPP__
 #define __BOK_BUILDSYSTEM_HPP__
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "BuildConfiguration.hpp"
+
 namespace bok {
     class Package;
     class Compiler;
     class Component;
     class BuildCache;
+    class BuildGraph;
     class Linker;
+    class JobScheduler;
+    class ObjectCache;
+    class DirectoryCache;
+    class IncludeScanner;
+    class WorkerPool;
+    class ResourceBudget;
     struct CompileOutput;
     struct LinkerOutput;
+    struct ProcessResult;
 
     class BuildSystem {
     public:
+        /**
+         * Receives the actions to run. When a JobScheduler is in use, both methods
+         * are invoked concurrently from its worker threads. They return the result of 
+         * the command they ran, whose resource usage gets recorded in the build cache.
+         */
         class Listener {
         public:
             virtual ~Listener() {}
             
-            virtual void receiveOutput(const CompileOutput &output) = 0;
+            virtual ProcessResult receiveOutput(const CompileOutput &output) = 0;
+
+            virtual ProcessResult receiveOutput(const LinkerOutput &output) = 0;
+
+            /**
+             * Notifies a compile whose object was restored from the object cache, instead of being run.
+             */
+            virtual void receiveCachedOutput(const CompileOutput &) {}
 
-            virtual void receiveOutput(const LinkerOutput &output) = 0;
+            /**
+             * Notifies a link that didn't have to run after all, because the inputs that were rebuilt came out unchanged.
+             */
+            virtual void receiveUnchangedOutput(const LinkerOutput &) {}
+
+            /**
+             * Notifies a compile that ran on a compile worker, instead of being run, along with its result (and diagnostics).
+             */
+            virtual void receiveRemoteOutput(const CompileOutput &, const ProcessResult &) {}
         };
 
     public:
-        explicit BuildSystem(Package *package, BuildCache *buildCache, Listener *listener = nullptr);
+        explicit BuildSystem(Package *package, BuildCache *buildCache, Listener *listener = nullptr, JobScheduler *scheduler = nullptr);
 
+        /**
+         * Builds every component of the package. Components are linked after the components they depend on, 
+         * and the ready actions with the longest remaining critical path are started first. Links whose 
+         * inputs, command line and output are unchanged are skipped, even when their inputs were rebuilt.
+         */
         void build(const Compiler &compiler, const Linker linker);
 
+        /**
+         * Enables restoring (and storing) compiled objects from a shared object cache.
+         */
+        void setObjectCache(ObjectCache *objectCache) {
+            this->objectCache = objectCache;
+        }
+
+        /**
+         * Hands compiles out to the compile workers of 'workerPool', when they have room for them.
+         */
+        void setWorkerPool(WorkerPool *workerPool) {
+            this->workerPool = workerPool;
+        }
+
+        /**
+         * Starts actions only while the memory they are expected to use fits in 'resourceBudget', 
+         * instead of just as many as the scheduler has workers.
+         */
+        void setResourceBudget(ResourceBudget *resourceBudget) {
+            this->resourceBudget = resourceBudget;
+        }
+
+        /**
+         * Keeps the directory listings read while expanding source patterns (recursive ones in particular), so unchanged 
+         * directories don't have to be read again.
+         */
+        void setDirectoryCache(DirectoryCache *directoryCache) {
+            this->directoryCache = directoryCache;
+        }
+
+        /**
+         * Finds what the sources include before compiling them, to tell apart heavy and light compiles 
+         * that haven't run before, and to synthesize prefix headers.
+         */
+        void setIncludeScanner(IncludeScanner *includeScanner) {
+            this->includeScanner = includeScanner;
+        }
+
+        /**
+         * Builds into the output directory of 'configuration', instead of next to the sources. Its flags 
+         * are up to the compiler and linker given to build().
+         */
+        void setConfiguration(const BuildConfiguration &configuration) {
+            this->configuration = configuration;
+        }
+
+        /**
+         * Compiles the sources of each component merged into unity translation units, of at most 
+         * 'maxBatchSize' sources each, and enough of them to keep the scheduler's workers busy.
+         */
+        void setUnityBuild(const bool enabled, const std::size_t maxBatchSize = 16) {
+            this->unityBuild = enabled;
+            this->unityBatchSize = maxBatchSize;
+        }
+
     private:
-        void build(const Compiler &compiler, const Linker linker, const Component *component);
+        std::vector<std::string> getSourceFiles(const Compiler &compiler, const Component *component) const;
+
+        std::vector<std::string> getTranslationUnits(const Component *component, const std::vector<std::string> &sources) const;
+
+        struct ComponentActions;
+
+        void addCompileActions(BuildGraph &graph, const Compiler &compiler, const Component *component, ComponentActions &actions);
+
+        void addLinkAction(BuildGraph &graph, const Linker &linker, const Component *component, std::map<const Component*, ComponentActions> &components, std::set<const Component*> &visiting);
+
+        std::string preparePrefixHeader(const Component *component, const std::vector<std::string> &sources) const;
+
+        struct ActionEstimate {
+            double duration = 0.0;          // in seconds
+            std::uint64_t memory = 0;       // the peak, in bytes
+        };
+
+        /**
+         * What each action of 'graph' is expected to take, from the history kept by the build cache. 
+         * The durations replace the costs of the actions in the graph.
+         */
+        std::vector<ActionEstimate> estimateActions(BuildGraph &graph, const Compiler &compiler) const;
+
+        /**
+         * Scales the costs of the compiles that never ran by how much they include (see IncludeScanner), 
+         * so the heaviest ones of a first build start first.
+         */
+        void weighUnknownCompiles(BuildGraph &graph, const Compiler &compiler, const std::vector<ActionEstimate> &estimates) const;
+
+        void execute(BuildGraph &graph, const std::vector<ActionEstimate> &estimates);
+
+        void runAction(const BuildGraph &graph, const std::uint32_t action);
+
+        bool compileRemotely(const CompileOutput &output);
+
+        std::string componentPath(const Component *component, const std::string &file) const;
+
+        std::string outputPath(const Component *component, const std::string &file) const;
+
+        std::string objectPath(const Component *component, const std::string &sourceFile) const;
+
+        struct ComponentDirectories {
+            std::string source;
+            std::string output;
+        };
 
     private:
         Package *package = nullptr;
         BuildCache *buildCache = nullptr;
         Listener *listener = nullptr;
+        JobScheduler *scheduler = nullptr;
+        ObjectCache *objectCache = nullptr;
+        DirectoryCache *directoryCache = nullptr;
+        IncludeScanner *includeScanner = nullptr;
+        WorkerPool *workerPool = nullptr;
+        ResourceBudget *resourceBudget = nullptr;
+        BuildConfiguration configuration;
+        std::map<const Component*, ComponentDirectories> directories;
+        bool unityBuild = false;
+        std::size_t unityBatchSize = 16;
     };
 }
 
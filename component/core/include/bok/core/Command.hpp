@@ -1,11 +1,54 @@
 
 #pragma once 
 
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
 #include <vector>
+#include <sys/resource.h>
 
 
 namespace bok {
+    /**
+     * Resources a command took to run. Zero means unknown, like the memory of commands that didn't run locally.
+     */
+    struct ResourceUsage {
+        std::uint64_t peakMemory = 0;       // maximum resident set size, in bytes
+        std::uint64_t cpuTime = 0;          // user plus system time, in microseconds
+        std::uint64_t wallTime = 0;         // in microseconds
+
+        bool isKnown() const {
+            return peakMemory != 0;
+        }
+    };
+
+
+    /**
+     * Outcome of a finished command.
+     */
+    struct ProcessResult {
+        int exitCode = 0;                   // 128 + signal number for processes killed by a signal
+        std::string standardOutput;
+        std::string standardError;
+        struct rusage usage {};
+        std::chrono::steady_clock::duration duration {};
+
+        bool succeeded() const {
+            return exitCode == 0;
+        }
+
+        ResourceUsage getResourceUsage() const {
+            // ru_maxrss is in kilobytes on Linux
+            return {
+                static_cast<std::uint64_t>(usage.ru_maxrss) * 1024, 
+                static_cast<std::uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + static_cast<std::uint64_t>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec), 
+                static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count())
+            };
+        }
+    };
+
+
     class Command {
     public:
         explicit Command(const std::string &path_, const std::string &name_);
@@ -14,11 +57,61 @@ namespace bok {
 
         Command& addArg(const std::string &arg);
 
-        void execute() const;
+        /**
+         * Lets the command receive its arguments through a '@file' response file when the command line 
+         * gets too long. Only for programs that understand them, like gcc.
+         */
+        Command& allowResponseFile(const bool allow = true) {
+            responseFile = allow;
+
+            return *this;
+        }
+
+        /**
+         * Runs the command to completion and returns its captured output. Throws a CommandError when 
+         * it can't be launched or doesn't exit successfully.
+         */
+        ProcessResult execute() const;
+
+        std::string getPath() const {
+            return path;
+        }
+
+        std::string getName() const {
+            return name;
+        }
+
+        const std::vector<std::string>& getArgs() const {
+            return args;
+        }
+
+        bool isResponseFileAllowed() const {
+            return responseFile;
+        }
+
+        /**
+         * The full command line, as it would be typed in a shell.
+         */
+        std::string toString() const;
         
     private:
         std::string path;
         std::string name;
         std::vector<std::string> args;
+        bool responseFile = false;
+    };
+
+
+    class CommandError : public std::runtime_error {
+    public:
+        explicit CommandError(const std::string &message, const ProcessResult &result_) 
+            : std::runtime_error(message), result(result_) {}
+
+        const ProcessResult& getResult() const {
+            return result;
+        }
+
+    private:
+        ProcessResult result;
     };
 }
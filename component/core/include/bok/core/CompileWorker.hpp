@@ -0,0 +1,68 @@
+
+#pragma once 
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "JobScheduler.hpp"
+#include "WorkerProtocol.hpp"
+
+
+namespace bok {
+    /**
+     * Compiles preprocessed sources for other machines (see WorkerPool), one connection per compile. 
+     * 
+     * A connection starts with a request type. Status requests are answered right away with the current 
+     * load (the compiles queued or running, and the job limit). Compile requests carry the command line, 
+     * whose "{input}" and "{output}" arguments stand for the files in a scratch directory, and the 
+     * preprocessed source; the response holds the exit code, the diagnostics, the object, and the load.
+     * 
+     * Only well-known compilers are run, with the flags of an allowlist: those that would load code, run 
+     * other programs or write outside the scratch directory are refused, as is anything unknown. 
+     * Still, a worker trusts its clients: it should only listen on a TCP port reachable from trusted hosts.
+     */
+    class CompileWorker {
+    public:
+        /**
+         * Listens on 'endpoint', compiling up to 'jobLimit' sources at a time (0 means one per hardware thread).
+         */
+        explicit CompileWorker(const WorkerEndpoint &endpoint, const int jobLimit = 0);
+
+        ~CompileWorker();
+
+        CompileWorker(const CompileWorker &) = delete;
+
+        CompileWorker& operator= (const CompileWorker &) = delete;
+
+        /**
+         * Serves until it's interrupted (SIGINT or SIGTERM).
+         */
+        void run();
+
+        /**
+         * Whether a worker is willing to run 'command'. Clients check it first, and compile locally what would be refused.
+         */
+        static bool isAllowedCommand(const std::vector<std::string> &command);
+
+    private:
+        /**
+         * Reads the request on 'clientFd', answering it or queueing the compile.
+         */
+        void serveConnection(const int clientFd);
+
+        void serveCompile(const int clientFd);
+
+        std::string compile(const std::vector<std::string> &command, const std::string &input);
+
+        std::string encodeLoad() const;
+
+    private:
+        WorkerEndpoint endpoint;
+        int listenFd = -1;
+        JobScheduler scheduler;
+        JobScheduler connections;
+        std::atomic<std::uint32_t> activeJobs = 0;
+    };
+}
@@ -1,13 +1,42 @@
 
 #pragma once 
 
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "Command.hpp"
 
 namespace bok {
+    /**
+     * How a source compiles, besides the flags of the compiler itself.
+     */
+    struct CompileOptions {
+        std::string prefixHeader = {};          // included first, through its precompiled form when available
+        bool positionIndependent = false;       // for code that goes into a shared library
+    };
+
+
     struct CompileOutput {
         std::string sourceFile;
         std::string objectFile;
+        std::string dependencyFile;     // empty when the compiler doesn't emit one
         Command command;
+        std::vector<std::string> implicitDependencies = {};   // inputs the depfile doesn't list, like the prefix header
+        CompileOptions options = {};
+    };
+
+
+    /**
+     * How to compile a source on another machine: 'preprocessCommand' runs locally, writing the 
+     * preprocessed source to 'preprocessedFile' (and the depfile, as a regular compile does), which 
+     * 'remoteCommand' then compiles on a worker. Its arguments "{input}" and "{output}" stand for 
+     * the preprocessed source and the object file on the worker.
+     */
+    struct RemoteCompile {
+        Command preprocessCommand;
+        std::string preprocessedFile;
+        Command remoteCommand;
     };
 
 
@@ -15,7 +44,33 @@ namespace bok {
     public:
         virtual ~Compiler();
 
-        virtual CompileOutput compile(const std::string &source) const = 0;
+        /**
+         * Compiles 'source' into 'object'. The directory of 'object' must exist.
+         */
+        virtual CompileOutput compile(const std::string &source, const std::string &object) const = 0;
+
+        /**
+         * Compiles 'source' with 'options'. By default, ignores them.
+         */
+        virtual CompileOutput compile(const std::string &source, const std::string &object, const CompileOptions &options) const;
+
+        /**
+         * Precompiles 'header', for the sources compiled with 'options'. Returns nothing when the compiler 
+         * doesn't support precompiled headers.
+         */
+        virtual std::optional<CompileOutput> precompileHeader(const std::string &header, const CompileOptions &options = {}) const;
+
+        /**
+         * Splits the compile of 'output' into a local and a remote part. Returns nothing when it can't be 
+         * compiled elsewhere, like precompiled headers.
+         */
+        virtual std::optional<RemoteCompile> prepareRemoteCompile(const CompileOutput &output) const;
+
+        /**
+         * The directories searched for included headers, in order, ending with those of the system. 
+         * Empty when unknown.
+         */
+        virtual std::vector<std::string> getIncludeDirectories() const;
 
         virtual bool isCompilable(const std::string &source) const = 0;
     };
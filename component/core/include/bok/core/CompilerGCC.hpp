@@ -9,20 +9,76 @@ namespace bok {
     public:
         virtual ~CompilerGCC() {}
 
-        CompileOutput compile(const std::string &source) const override;
+        CompileOutput compile(const std::string &source, const std::string &object) const override;
+
+        CompileOutput compile(const std::string &source, const std::string &object, const CompileOptions &options) const override;
+
+        std::optional<CompileOutput> precompileHeader(const std::string &header, const CompileOptions &options = {}) const override;
+
+        std::optional<RemoteCompile> prepareRemoteCompile(const CompileOutput &output) const override;
+
+        /**
+         * Asks gcc, with the flags in effect (which takes running it).
+         */
+        std::vector<std::string> getIncludeDirectories() const override;
+
+        /**
+         * Leaves the debug information in separate '.dwo' files, which keeps it out of the link.
+         */
+        CompilerGCC& setSplitDwarf(const bool splitDwarf) {
+            this->splitDwarf = splitDwarf;
+
+            return *this;
+        }
+
+        /**
+         * Replaces the optimization and debugging flags (by default, those of a debug build).
+         */
+        CompilerGCC& setFlags(const std::vector<std::string> &flags) {
+            this->flags = flags;
+
+            return *this;
+        }
 
         bool isCompilable(const std::string &source) const override;
 
     private:
+        /**
+         * Flags shared by every translation unit and precompiled header. They must match, or gcc 
+         * silently ignores the precompiled header.
+         */
+        Command& addCommonFlags(Command &command, const CompileOptions &options) const {
+            command.addArg("-std=c++17");
+
+            if (options.positionIndependent) {
+                command.addArg("-fPIC");
+            }
+
+            for (const std::string &flag : flags) {
+                command.addArg(flag);
+            }
+
+            if (splitDwarf) {
+                command.addArg("-gsplit-dwarf");
+            }
+
+            return command;
+        }
+
+
         Command createCompilerCommand() const {
             // return Command{"clang"};
             return Command{"gcc"};
         }
 
 
-        std::string objectName(const std::string &source) const {
-            return source + ".obj";
+        std::string dependencyName(const std::string &object) const {
+            return object + ".d";
         }
+
+    private:
+        bool splitDwarf = false;
+        std::vector<std::string> flags = {"-O0", "-g"};
     };
 }
 
@@ -7,16 +7,26 @@
 namespace bok {
     class Package;
     class Component {
+    public:
+        /**
+         * What the component builds into: a program, or a library other components link against.
+         */
+        enum class Type {
+            Executable,
+            StaticLibrary,
+            SharedLibrary
+        };
+
     public:
         explicit Component(const Package *parentPackage, const std::string &name, const std::string &path, const std::vector<std::string> &sources);
 
 
-        std::vector<std::string> getSources() const {
+        const std::vector<std::string>& getSources() const {
             return sources;
         }
 
 
-        std::string getName() const {
+        const std::string& getName() const {
             return name;
         }
 
@@ -26,14 +36,75 @@ namespace bok {
         }
 
 
-        std::string getPath() const {
+        const std::string& getPath() const {
             return path;
         }
 
+
+        Component* setType(const Type type) {
+            this->type = type;
+
+            return this;
+        }
+
+
+        Type getType() const {
+            return type;
+        }
+
+
+        /**
+         * Declares that this component links against 'dependency', which must be built first.
+         */
+        Component* addDependency(const Component *dependency) {
+            dependencies.push_back(dependency);
+
+            return this;
+        }
+
+
+        const std::vector<const Component*>& getDependencies() const {
+            return dependencies;
+        }
+
+
+        /**
+         * Sets a header (relative to the component path) to precompile and include first in every source.
+         */
+        Component* setPrefixHeader(const std::string &prefixHeader) {
+            this->prefixHeader = prefixHeader;
+
+            return this;
+        }
+
+
+        const std::string& getPrefixHeader() const {
+            return prefixHeader;
+        }
+
+
+        /**
+         * Without a declared prefix header, synthesizes one from the system headers most sources include.
+         */
+        Component* setAutomaticPrefixHeader(const bool automatic) {
+            automaticPrefixHeader = automatic;
+
+            return this;
+        }
+
+
+        bool hasAutomaticPrefixHeader() const {
+            return automaticPrefixHeader;
+        }
+
     private:
         const Package *parentPackage = nullptr;
         std::string name;
         std::string path;
+        Type type = Type::Executable;
         std::vector<std::string> sources;
+        std::vector<const Component*> dependencies;
+        std::string prefixHeader;
+        bool automaticPrefixHeader = false;
     };
 }
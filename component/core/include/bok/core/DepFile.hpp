@@ -0,0 +1,19 @@
+
+#pragma once 
+
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    /**
+     * Parses the contents of a Makefile-style dependency file, as written by 'gcc -MMD -MF',
+     * and returns the prerequisites of every rule, in order and without duplicates.
+     */
+    std::vector<std::string> parseDepFile(const std::string &content);
+
+    /**
+     * Reads and parses the dependency file at 'path'. Returns an empty list when it can't be read.
+     */
+    std::vector<std::string> loadDepFile(const std::string &path);
+}
@@ -0,0 +1,74 @@
+
+#pragma once 
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace bok {
+    struct DirectoryEntry {
+        enum class Type : std::uint8_t {
+            File,
+            Directory,
+            Other       // anything not to be walked into, like a symbolic link to a directory
+        };
+
+        std::string name;
+        Type type = Type::File;
+    };
+
+
+    /**
+     * Directory listings from previous walks, keyed on the modification time (and inode) of each directory, 
+     * which changes whenever an entry is added, removed or renamed in it. 
+     * 
+     * The listings used during a run are written back to 'cacheFile' on destruction, so walking an 
+     * unchanged tree again costs a stat per directory, instead of reading all of them.
+     */
+    class DirectoryCache {
+    public:
+        /**
+         * Loads the listings stored in 'cacheFile'. An empty path keeps them in memory only.
+         */
+        explicit DirectoryCache(const std::string &cacheFile = "");
+
+        ~DirectoryCache();
+
+        DirectoryCache(const DirectoryCache &) = delete;
+
+        DirectoryCache& operator= (const DirectoryCache &) = delete;
+
+        /**
+         * The listing of 'path', if the one stored is still current.
+         */
+        std::optional<std::vector<DirectoryEntry>> find(const std::string &path, const std::int64_t modifiedTime, const std::uint64_t inode);
+
+        void store(const std::string &path, const std::int64_t modifiedTime, const std::uint64_t inode, const std::vector<DirectoryEntry> &entries);
+
+        /**
+         * Writes the listings used since the cache was loaded.
+         */
+        void save();
+
+    private:
+        struct Listing {
+            std::int64_t modifiedTime = 0;
+            std::uint64_t inode = 0;
+            std::vector<DirectoryEntry> entries;
+            bool used = false;
+        };
+
+        void load();
+
+    private:
+        std::string cacheFile;
+        bool changed = false;
+
+        std::mutex mutex;
+        std::unordered_map<std::string, Listing> listings;
+    };
+}
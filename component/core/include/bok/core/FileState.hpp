@@ -0,0 +1,41 @@
+
+#pragma once 
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+
+namespace bok {
+    /**
+     * What the build cache knows about a file. The stat tuple is cheap to get and is compared first;
+     * the content hash is only consulted when the stat tuple changed.
+     */
+    struct FileState {
+        std::int64_t modifiedTime = 0;      // nanoseconds since the epoch
+        std::uint64_t size = 0;
+        std::uint64_t inode = 0;
+        std::uint64_t contentHash = 0;
+
+        bool sameStat(const FileState &other) const {
+            return modifiedTime == other.modifiedTime && size == other.size && inode == other.inode;
+        }
+    };
+
+
+    /**
+     * Stats 'path', without hashing it. Returns nothing when the file doesn't exist.
+     */
+    std::optional<FileState> statFile(const std::string &path);
+
+    /**
+     * Stats and hashes 'path'.
+     */
+    std::optional<FileState> scanFile(const std::string &path);
+
+    /**
+     * Writes 'content' to the generated file 'path', unless it already has that exact content, 
+     * so its state doesn't change needlessly. Returns whether it was written.
+     */
+    bool writeFileIfChanged(const std::string &path, const std::string &content);
+}
@@ -0,0 +1,76 @@
+
+#pragma once 
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FileState.hpp"
+
+
+namespace bok {
+    class JobScheduler;
+
+    /**
+     * The state of the files looked at during a build, each one stated (and hashed, when asked for) 
+     * at most once, however many sources share it. Safe to use from several threads.
+     */
+    class FileStateSnapshot {
+    public:
+        /**
+         * The stat information of 'path', without its content hash.
+         */
+        std::optional<FileState> stat(const std::string &path);
+
+        /**
+         * The stat information of 'path', along with its content hash. When the file changed since it was 
+         * stated, returns an empty state instead, which matches no file, so whoever records it checks 
+         * the file again next time.
+         */
+        std::optional<FileState> scan(const std::string &path);
+
+        /**
+         * Stats every path not in the snapshot yet, in batches spread over the workers of 'scheduler'. 
+         * Waits for the scheduler to run out of jobs, so it must not be called from one of them.
+         */
+        void prefetch(const std::vector<std::string> &paths, JobScheduler *scheduler = nullptr);
+
+        /**
+         * Drops the state of a file that was just written, so it's stated again when needed.
+         */
+        void invalidate(const std::string &path);
+
+        /**
+         * Stats 'paths' again. Returns the ones whose state changed.
+         */
+        std::vector<std::string> refresh(const std::vector<std::string> &paths);
+
+        void clear();
+
+        std::vector<std::string> getPaths() const;
+
+        /**
+         * How many stat calls the snapshot made, since it was created.
+         */
+        std::size_t getStatCount() const {
+            return statCount;
+        }
+
+    private:
+        struct Entry {
+            std::optional<FileState> state;
+            bool hashed = false;
+        };
+
+        std::optional<FileState> statUncached(const std::string &path);
+
+    private:
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        std::atomic<std::size_t> statCount = 0;
+    };
+}
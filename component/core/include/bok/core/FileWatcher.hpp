@@ -0,0 +1,58 @@
+
+#pragma once 
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    /**
+     * Watches a set of files for changes with inotify. 
+     * 
+     * The watches are placed on the directories holding the files, so changes are still seen when an 
+     * editor saves by replacing the file. Changes are reported with the same spelling the files were 
+     * watched with.
+     */
+    class FileWatcher {
+    public:
+        FileWatcher();
+
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher &) = delete;
+
+        FileWatcher& operator= (const FileWatcher &) = delete;
+
+        /**
+         * Starts watching 'file'. Returns false when its directory can't be watched (for instance, 
+         * because it doesn't exist).
+         */
+        bool watch(const std::string &file);
+
+        bool isWatching(const std::string &file) const {
+            return watchedFiles.count(file) > 0;
+        }
+
+        /**
+         * Reads the pending events, without blocking. Returns the watched files that changed, and sets 
+         * 'overflowed' when events were lost, in which case any watched file could have changed.
+         */
+        std::vector<std::string> readChanges(bool &overflowed);
+
+        /**
+         * The inotify descriptor, readable when there are pending events.
+         */
+        int getFd() const {
+            return fd;
+        }
+
+    private:
+        int fd = -1;
+
+        // for each watched directory, the spellings of the files watched in it, by name
+        std::map<int, std::map<std::string, std::vector<std::string>>> directories;
+        std::set<std::string> watchedFiles;
+    };
+}
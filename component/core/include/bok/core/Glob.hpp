@@ -0,0 +1,33 @@
+
+#pragma once 
+
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    class DirectoryCache;
+    class JobScheduler;
+
+    /**
+     * Whether 'value' has any wildcard in it.
+     */
+    bool isGlobPattern(const std::string &value);
+
+    /**
+     * Matches a '/' separated path against 'pattern', where '*' matches any run of characters within a 
+     * path segment, '?' any single character, and a '**' segment any number of segments (so "src"
+     * followed by a '**' segment matches every file under "src").
+     */
+    bool matchGlob(const std::string &pattern, const std::string &path);
+
+    /**
+     * Lists the files under 'root' matching any of 'patterns', as sorted paths relative to 'root'. 
+     * 
+     * Only the directories that can hold a match are walked, in parallel on the workers of 'scheduler' 
+     * (which must have no other jobs running) and relative to their parent's descriptor. Listings are 
+     * taken from 'cache' for the directories that didn't change since the last walk. Hidden entries 
+     * (starting with '.') are skipped, and symbolic links to directories are not followed.
+     */
+    std::vector<std::string> expandGlobs(const std::string &root, const std::vector<std::string> &patterns, DirectoryCache *cache = nullptr, JobScheduler *scheduler = nullptr);
+}
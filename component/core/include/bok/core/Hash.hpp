@@ -0,0 +1,24 @@
+
+#pragma once 
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+
+namespace bok {
+    /**
+     * 64-bit xxHash (XXH64) of a memory block.
+     */
+    std::uint64_t hashBytes(const void *data, const std::size_t size, const std::uint64_t seed = 0);
+
+    inline std::uint64_t hashString(const std::string &value, const std::uint64_t seed = 0) {
+        return hashBytes(value.data(), value.size(), seed);
+    }
+
+    /**
+     * XXH64 of the contents of a file. Returns nothing when it can't be read.
+     */
+    std::optional<std::uint64_t> hashFile(const std::string &path);
+}
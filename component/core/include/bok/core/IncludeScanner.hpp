@@ -0,0 +1,80 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "FileState.hpp"
+
+
+namespace bok {
+    struct IncludeDirective {
+        std::string header;         // as written, between the quotes or the angle brackets
+        bool system = false;        // '#include <...>'
+    };
+
+
+    /**
+     * Finds the headers a translation unit includes without running the preprocessor, so the build
+     * can tell how heavy a compile is before it has ever run.
+     *
+     * It looks for '#' with memchr (which the C library vectorizes) instead of walking every character,
+     * and only inspects the lines they start. Conditionals aren't evaluated and computed includes
+     * ('#include MACRO') are skipped, so what it finds is close to, but not exactly, what the compiler reads.
+     *
+     * The directives of each file are kept by content hash, and a file whose stat tuple didn't change
+     * isn't read again. Thread-safe.
+     */
+    class IncludeScanner {
+    public:
+        struct Closure {
+            std::vector<std::string> files;         // the source first, then every header reached from it
+            std::uint64_t size = 0;                 // of all those files, in bytes
+            std::size_t unresolvedCount = 0;        // includes found in none of the directories
+        };
+
+        /**
+         * The '#include' directives in 'content', in order.
+         */
+        static std::vector<IncludeDirective> scan(std::string_view content);
+
+        /**
+         * The directives of 'file'. Nothing when it can't be read.
+         */
+        std::shared_ptr<const std::vector<IncludeDirective>> getIncludes(const std::string &file);
+
+        /**
+         * The headers reached from each of 'sources'. Quoted includes are looked up next to the file
+         * including them first, then (like the others) in 'includeDirectories', in order.
+         */
+        std::vector<Closure> findClosures(const std::vector<std::string> &sources, const std::vector<std::string> &includeDirectories);
+
+        std::size_t getScanCount() const {
+            return scanCount;
+        }
+
+    private:
+        struct FileEntry {
+            FileState state;
+            std::shared_ptr<const std::vector<IncludeDirective>> includes;
+        };
+
+        /**
+         * The stat tuple and directives of 'file'. Nothing when it isn't a regular file, or can't be read.
+         */
+        std::optional<FileEntry> findEntry(const std::string &file);
+
+    private:
+        std::mutex mutex;
+        std::unordered_map<std::string, FileEntry> files;
+        std::unordered_map<std::uint64_t, std::shared_ptr<const std::vector<IncludeDirective>>> scans;
+        std::atomic<std::size_t> scanCount = 0;
+    };
+}
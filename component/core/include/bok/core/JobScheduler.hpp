@@ -0,0 +1,94 @@
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace bok {
+    /**
+     * Fixed-size worker pool. Every worker owns a job deque: it pops its own jobs from the back
+     * and steals from the front of the other workers' deques when it runs out of work.
+     */
+    class JobScheduler {
+    public:
+        using Job = std::function<void()>;
+
+    public:
+        /**
+         * Creates a scheduler with 'jobLimit' workers (0 means one per hardware thread).
+         * When 'keepGoing' is false, the first failed job cancels every job still pending.
+         */
+        explicit JobScheduler(const int jobLimit = 0, const bool keepGoing = false);
+
+        ~JobScheduler();
+
+        JobScheduler(const JobScheduler &) = delete;
+
+        JobScheduler& operator= (const JobScheduler &) = delete;
+
+        void submit(Job job);
+
+        /**
+         * Blocks until every submitted job has either run or been cancelled.
+         */
+        void wait();
+
+        int getJobLimit() const {
+            return static_cast<int>(workers.size());
+        }
+
+        bool isKeepGoing() const {
+            return keepGoing;
+        }
+
+        bool hasFailed() const {
+            return failureCount > 0;
+        }
+
+        std::size_t getFailureCount() const {
+            return failureCount;
+        }
+
+        /**
+         * Rethrows the exception raised by the first failed job, if any.
+         */
+        void rethrowFailure() const;
+
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+            std::thread thread;
+        };
+
+        void workerMain(const std::size_t index);
+
+        bool popJob(const std::size_t index, Job &job);
+
+        void runJob(Job &job);
+
+    private:
+        bool keepGoing = false;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<std::size_t> nextWorker = 0;
+
+        mutable std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable idle;
+        std::size_t queuedJobs = 0;
+        std::size_t activeJobs = 0;
+        bool stopping = false;
+
+        std::atomic<std::size_t> failureCount = 0;
+        std::exception_ptr firstFailure;
+    };
+}
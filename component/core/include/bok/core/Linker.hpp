@@ -6,13 +6,80 @@
 namespace bok {
     struct LinkerOutput {
         std::vector<std::string> objectFiles;
-        std::string executable;
+        std::string executable;                         // the program or library it writes
         Command command;
+        std::vector<std::string> dependencies = {};     // what it takes from the components linked before this one
+        std::string interfaceFile = {};                 // for shared libraries, the symbols they export (see Linker::writeInterface)
+
+        /**
+         * The files whose content decides whether the link has to be redone.
+         */
+        std::vector<std::string> getInputs() const {
+            std::vector<std::string> inputs = objectFiles;
+            inputs.insert(inputs.end(), dependencies.begin(), dependencies.end());
+
+            return inputs;
+        }
     };
 
 
     class Linker {
     public:
-        LinkerOutput link(const std::string &name, const std::string &outputFilePath, const std::vector<std::string> &objects) const;
+        /**
+         * Links an executable. 'libraries' are static archives and shared libraries, in link order.
+         */
+        LinkerOutput link(const std::string &name, const std::string &outputFilePath, const std::vector<std::string> &objects, const std::vector<std::string> &libraries = {}) const;
+
+        /**
+         * Links a shared library, from objects compiled as position-independent code.
+         */
+        LinkerOutput linkSharedLibrary(const std::string &name, const std::string &outputFilePath, const std::vector<std::string> &objects, const std::vector<std::string> &libraries = {}) const;
+
+        /**
+         * Archives a static library. The archive is thin: it refers to the objects instead of copying them,
+         * so rebuilding it only rewrites the index.
+         */
+        LinkerOutput archive(const std::string &name, const std::string &outputFilePath, const std::vector<std::string> &objects) const;
+
+        /**
+         * Links through another linker, with gcc's '-fuse-ld=' (like "mold" or "lld"). Empty for the default one.
+         */
+        Linker& setLinkerFlavor(const std::string &flavor) {
+            linkerFlavor = flavor;
+
+            return *this;
+        }
+
+        std::string getLinkerFlavor() const {
+            return linkerFlavor;
+        }
+
+        /**
+         * Flags passed to every link, like those of the build configuration.
+         */
+        Linker& setFlags(const std::vector<std::string> &flags) {
+            this->flags = flags;
+
+            return *this;
+        }
+
+        /**
+         * Returns the fastest linker flavor installed ("mold", then "lld"), or an empty string when there's none.
+         */
+        static std::string findFastLinker();
+
+        /**
+         * Writes the dynamic symbols 'library' exports (their names and kinds, and the sizes of the data ones)
+         * to 'interfaceFile', unless they're the same as before. Those linking against the library only have
+         * to be linked again when this file changes. Returns whether it was written.
+         */
+        static bool writeInterface(const std::string &library, const std::string &interfaceFile);
+
+    private:
+        Command createLinkCommand(const std::vector<std::string> &objects, const std::vector<std::string> &libraries) const;
+
+    private:
+        std::string linkerFlavor;
+        std::vector<std::string> flags;
     };
 }
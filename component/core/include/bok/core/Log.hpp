@@ -0,0 +1,167 @@
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+
+namespace bok {
+    enum class LogLevel : std::uint8_t {
+        Error,
+        Warning,
+        Info,
+        Verbose,
+        Debug
+    };
+
+
+    /**
+     * Asynchronous log sink. Callers format a record and push it into a bounded, lock-free ring buffer;
+     * a single writer thread drains it and writes every batch with one flush, so build workers never
+     * wait on the terminal.
+     *
+     * Errors and warnings go to the error stream, the rest to the output stream. A record is written as
+     * a whole, so a multi-line block (like the diagnostics of one compile) is never interleaved with others.
+     * When the queue is full, errors, warnings and info records wait for room, while verbose and debug
+     * records are dropped and counted.
+     */
+    class Log {
+    public:
+        Log();
+
+        ~Log();
+
+        Log(const Log &) = delete;
+
+        Log& operator= (const Log &) = delete;
+
+        void setLevel(const LogLevel level) {
+            this->level.store(level, std::memory_order_relaxed);
+        }
+
+        LogLevel getLevel() const {
+            return level.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Cheap enough to guard logging on hot paths, before any formatting takes place.
+         */
+        bool isEnabled(const LogLevel level) const {
+            return level <= this->level.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Writes the concatenation of 'parts' as one line, if 'level' is enabled.
+         */
+        template<typename ...Parts>
+        void print(const LogLevel level, const Parts &...parts) {
+            if (! this->isEnabled(level)) {
+                return;
+            }
+
+            std::ostringstream os;
+            (os << ... << parts) << "\n";
+
+            this->write(level, os.str());
+        }
+
+        /**
+         * Writes 'text' as is, if 'level' is enabled.
+         */
+        void write(const LogLevel level, std::string text);
+
+        /**
+         * Replaces the status line shown below the log, used for the build progress.
+         * Does nothing unless the output is a terminal, and info records are enabled.
+         */
+        void setStatus(std::string status);
+
+        bool hasStatusLine() const {
+            return statusLine.load(std::memory_order_relaxed) && this->isEnabled(LogLevel::Info);
+        }
+
+        /**
+         * Sends everything written from now on to 'stream' (nullptr restores the standard streams).
+         * Every record already queued is written to the previous streams first.
+         */
+        void redirect(std::ostream *stream);
+
+        /**
+         * Blocks until every record queued so far has been written.
+         */
+        void flush();
+
+        std::size_t getDroppedCount() const {
+            return droppedCount;
+        }
+
+        static Log& getDefault();
+
+    private:
+        enum class RecordType : std::uint8_t {
+            Text,
+            Status
+        };
+
+        struct Record {
+            RecordType type = RecordType::Text;
+            LogLevel level = LogLevel::Info;
+            std::string text;
+        };
+
+        struct Slot {
+            std::atomic<std::size_t> sequence;
+            Record record;
+        };
+
+        bool tryPush(Record &record);
+
+        bool tryPop(Record &record);
+
+        void push(Record record, const bool mayDrop);
+
+        void writerMain();
+
+        void writeBatch();
+
+        void clearStatus();
+
+        void drawStatus();
+
+        void updateStatusLine();
+
+    private:
+        std::atomic<LogLevel> level = LogLevel::Info;
+        std::atomic<bool> statusLine = false;
+        std::atomic<std::size_t> droppedCount = 0;
+
+        std::size_t capacity = 0;
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<std::size_t> enqueuePosition = 0;
+        std::size_t dequeuePosition = 0;
+
+        // the writer sleeps on 'wake' between batches; 'written' tells flush() how far it got
+        std::mutex writerMutex;
+        std::condition_variable wake;
+        std::condition_variable written;
+        std::atomic<bool> writerSleeping = false;
+        std::size_t writtenPosition = 0;
+        bool stopping = false;
+
+        // owned by the writer thread, except while a redirect swaps the streams
+        std::ostream *output = nullptr;
+        std::ostream *errors = nullptr;
+        std::string status;
+        bool statusShown = false;
+
+        std::thread writer;
+    };
+}
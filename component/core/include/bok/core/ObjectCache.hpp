@@ -0,0 +1,80 @@
+
+#pragma once 
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    struct CompileOutput;
+
+    /**
+     * Content-addressed store of compiled objects, shareable between checkouts and build directories.
+     * 
+     * Lookups work like ccache's direct mode: the compiler identity, the command line and the source 
+     * contents select a manifest, which lists the header sets seen so far for that combination along 
+     * with the resulting object. An entry is a hit when every header in its set still has the same 
+     * content. Objects are restored by reflink, hardlink (when enabled) or copy.
+     * 
+     * Several processes may use the same directory: updates are guarded by an advisory lock, and every 
+     * file is written aside and renamed into place. Once the store grows past its size limit, the least 
+     * recently used objects and manifests (both count towards it) are evicted.
+     */
+    class ObjectCache {
+    public:
+        explicit ObjectCache(const std::string &directory, const std::uint64_t maxSize = DEFAULT_MAX_SIZE, const bool useHardLinks = false);
+
+        /**
+         * Restores the object (and depfile) of 'output' from the store. Returns false on a miss.
+         */
+        bool restore(const CompileOutput &output);
+
+        /**
+         * Saves the object (and depfile) just produced by 'output' into the store.
+         */
+        void store(const CompileOutput &output);
+
+        std::string getDirectory() const {
+            return directory;
+        }
+
+    public:
+        static constexpr std::uint64_t DEFAULT_MAX_SIZE = 5ull * 1024 * 1024 * 1024;
+
+    private:
+        struct ManifestEntry {
+            std::uint64_t objectKey = 0;
+            std::vector<std::pair<std::string, std::uint64_t>> dependencies;
+        };
+
+        std::optional<std::uint64_t> computeManifestKey(const CompileOutput &output);
+
+        std::uint64_t getCompilerIdentity(const std::string &compiler);
+
+        std::vector<ManifestEntry> readManifest(const std::string &manifestFile) const;
+
+        void writeManifest(const std::string &manifestFile, const std::vector<ManifestEntry> &entries) const;
+
+        std::string manifestPath(const std::uint64_t key) const;
+
+        std::string objectPath(const std::uint64_t key) const;
+
+        bool placeFile(const std::string &from, const std::string &to, const bool allowHardLink) const;
+
+        void addToSize(const std::int64_t delta);
+
+        void evict();
+
+    private:
+        std::string directory;
+        std::uint64_t maxSize = DEFAULT_MAX_SIZE;
+        bool useHardLinks = false;
+
+        std::mutex mutex;
+        std::map<std::string, std::uint64_t> compilerIdentities;
+    };
+}
@@ -1,28 +1,44 @@
 
 #pragma once 
 
+#include <deque>
 #include <string>
 #include <vector>
 
+#include "Component.hpp"
+
 namespace bok {
-    class Component;
     class Package {
     public:
         explicit Package(const std::string &name, const std::string &path);
 
+        Package(const Package &) = delete;
+
+        Package& operator= (const Package &) = delete;
+
+        /**
+         * Adds a component, owned by the package.
+         */
         Component* addComponent(const std::string &name, const std::string &path, const std::vector<std::string> &sources);
         
-        std::vector<Component*> getComponents() const {
+        const std::vector<Component*>& getComponents() const {
             return components;
         }
 
-        std::string getPath() const {
+        const std::string& getName() const {
+            return name;
+        }
+
+        const std::string& getPath() const {
             return path;
         }
 
     private:
         std::string name;
         std::string path;
+
+        // a deque never moves its elements, so the components can be referred to by pointer
+        std::deque<Component> storage;
         std::vector<Component*> components;
     };
 }
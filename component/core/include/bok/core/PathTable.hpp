@@ -0,0 +1,59 @@
+
+#pragma once 
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace bok {
+    using PathId = std::uint32_t;
+
+    /**
+     * Interns paths: each distinct path is stored once, in large arena blocks, and is referred to by a 
+     * small integer. Views returned by get() stay valid for the lifetime of the table.
+     */
+    class PathTable {
+    public:
+        PathTable() = default;
+
+        PathTable(const PathTable &) = delete;
+
+        PathTable& operator= (const PathTable &) = delete;
+
+        /**
+         * Returns the id of 'path', adding it to the table the first time it's seen.
+         */
+        PathId intern(std::string_view path);
+
+        /**
+         * Returns the id of 'path', if it was interned.
+         */
+        const PathId* find(std::string_view path) const;
+
+        std::string_view get(const PathId id) const {
+            return paths[id];
+        }
+
+        std::size_t getPathCount() const {
+            return paths.size();
+        }
+
+    private:
+        std::string_view store(std::string_view path);
+
+    private:
+        static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::size_t blockUsed = BLOCK_SIZE;
+        std::vector<std::unique_ptr<char[]>> largePaths;
+
+        std::vector<std::string_view> paths;
+        std::unordered_map<std::string_view, PathId> ids;
+    };
+}
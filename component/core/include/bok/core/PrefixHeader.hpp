@@ -0,0 +1,22 @@
+
+#pragma once 
+
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    class IncludeScanner;
+
+    /**
+     * Returns the system headers ('#include <...>') reached by at least 'minimumShare' of 'sources', directly or 
+     * through their local headers, in order of first appearance.
+     */
+    std::vector<std::string> findCommonSystemHeaders(IncludeScanner &scanner, const std::vector<std::string> &sources, const double minimumShare = 0.5);
+
+    /**
+     * Writes a prefix header including 'headers' to 'path'. The file is left untouched when its content 
+     * wouldn't change, so it isn't considered modified.
+     */
+    void writePrefixHeader(const std::string &path, const std::vector<std::string> &headers);
+}
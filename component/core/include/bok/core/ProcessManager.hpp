@@ -0,0 +1,75 @@
+
+#pragma once 
+
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Command.hpp"
+
+
+namespace bok {
+    /**
+     * Launches commands with posix_spawn, without going through a shell, and supervises all of them 
+     * from a single event loop thread: completions arrive through pidfds and captured output through
+     * pipes, all multiplexed with epoll.
+     */
+    class ProcessManager {
+    public:
+        ProcessManager();
+
+        ~ProcessManager();
+
+        ProcessManager(const ProcessManager &) = delete;
+
+        ProcessManager& operator= (const ProcessManager &) = delete;
+
+        /**
+         * Starts 'command' and returns immediately. The result becomes available when the process exits 
+         * and both of its output streams are closed.
+         */
+        std::future<ProcessResult> spawn(const Command &command);
+
+        ProcessResult run(const Command &command) {
+            return this->spawn(command).get();
+        }
+
+        static ProcessManager& getDefault();
+
+    public:
+        // command lines longer than this go through a response file, when the command allows it
+        static constexpr std::size_t RESPONSE_FILE_THRESHOLD = 64 * 1024;
+
+    private:
+        struct Process;
+
+        void eventLoop();
+
+        void registerProcess(std::unique_ptr<Process> process);
+
+        void readOutput(Process &process, const int fd);
+
+        void reapProcess(Process &process);
+
+        void finishIfDone(Process &process);
+
+    private:
+        int epollFd = -1;
+        int wakeFd = -1;
+        std::thread eventThread;
+        std::atomic<bool> stopping = false;
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Process>> incoming;
+
+        // owned by the event loop thread
+        std::map<int, Process*> fdOwners;
+        std::map<Process*, std::unique_ptr<Process>> processes;
+        std::atomic<std::size_t> responseFileCount = 0;
+    };
+}
@@ -0,0 +1,92 @@
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+
+namespace bok {
+    /**
+     * Admission control for build actions. Each action reserves the memory it is expected to use (its peak
+     * in the previous build), and only starts while the reservations fit in the memory limit. Links, which
+     * tend to be the largest actions, have a smaller pool of their own.
+     *
+     * Besides, the free memory and the load average of the machine are sampled every now and then, so the
+     * build backs off when something else needs the machine.
+     *
+     * Not thread-safe: the build system calls it while holding its own scheduling lock.
+     */
+    class ResourceBudget {
+    public:
+        /**
+         * A 'memoryLimit' of 0 takes the memory limit of the cgroup the process runs in, or else the physical
+         * memory. A 'linkJobLimit' of 0 allows a quarter of the jobs (but at least one) to be links.
+         */
+        explicit ResourceBudget(const std::uint64_t memoryLimit = 0, const std::size_t linkJobLimit = 0);
+
+        std::uint64_t getMemoryLimit() const {
+            return memoryLimit;
+        }
+
+        std::size_t getLinkJobLimit(const std::size_t jobLimit) const;
+
+        /**
+         * Reserves 'memory' for an action, if it can start now with 'running' actions already running (out of
+         * 'jobLimit'). An action always starts when nothing else runs, however large it is.
+         */
+        bool tryReserve(const bool link, const std::uint64_t memory, const std::size_t running, const std::size_t jobLimit);
+
+        void release(const bool link, const std::uint64_t memory);
+
+        std::uint64_t getReservedMemory() const {
+            return reservedMemory;
+        }
+
+        std::uint64_t getPeakReservedMemory() const {
+            return peakReservedMemory;
+        }
+
+        /**
+         * The memory limit of the cgroup of this process, if it has one.
+         */
+        static std::optional<std::uint64_t> readCgroupMemoryLimit();
+
+        /**
+         * The memory that can be used without swapping, from /proc/meminfo, and the cgroup limit.
+         */
+        static std::optional<std::uint64_t> readAvailableMemory();
+
+        static std::optional<std::uint64_t> readTotalMemory();
+
+        /**
+         * The one-minute load average.
+         */
+        static std::optional<double> readLoadAverage();
+
+    public:
+        // assumed for actions never run before, when no other action of the same kind has run either
+        static constexpr std::uint64_t DEFAULT_COMPILE_MEMORY = 512ull * 1024 * 1024;
+        static constexpr std::uint64_t DEFAULT_LINK_MEMORY = 1024ull * 1024 * 1024;
+
+    private:
+        void sample(const std::size_t running);
+
+    private:
+        std::uint64_t memoryLimit = 0;
+        std::size_t linkJobLimit = 0;
+        std::size_t hardwareThreads = 1;
+
+        std::uint64_t reservedMemory = 0;
+        std::uint64_t peakReservedMemory = 0;
+        std::size_t runningLinks = 0;
+
+        // what the last sample saw, and what has been reserved since, but may not be in use yet
+        std::chrono::steady_clock::time_point lastSample;
+        std::optional<std::uint64_t> availableMemory;
+        std::uint64_t reservedSinceSample = 0;
+        std::size_t loadExcess = 0;
+    };
+}
@@ -0,0 +1,104 @@
+
+#pragma once 
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    /**
+     * Collects timed events, in the Chrome trace-event format (readable by chrome://tracing and Perfetto), 
+     * plus a set of named build metrics.
+     * 
+     * Events are grouped in lanes, one for each thread that records them. Recording is a no-op until the 
+     * trace is enabled; metrics are always collected.
+     */
+    class Trace {
+    public:
+        /**
+         * Times the enclosing block as a single event, on the lane of the current thread.
+         */
+        class Scope {
+        public:
+            explicit Scope(Trace &trace, const std::string &name, const std::string &category);
+
+            ~Scope();
+
+            Scope(const Scope &) = delete;
+
+            Scope& operator= (const Scope &) = delete;
+
+            void setArg(const std::string &key, const std::string &value);
+
+            void setArg(const std::string &key, const std::int64_t value);
+
+        private:
+            Trace &trace;
+            bool enabled = false;
+            std::string name;
+            std::string category;
+            std::chrono::steady_clock::time_point start;
+            std::map<std::string, std::string> args;
+            Scope *parent = nullptr;
+        };
+
+    public:
+        Trace();
+
+        void enable() {
+            enabled = true;
+        }
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        /**
+         * Adds an argument to the innermost scope open in the current thread, if any.
+         */
+        static void annotate(const std::string &key, const std::int64_t value);
+
+        void count(const std::string &metric, const std::int64_t delta = 1);
+
+        void setMetric(const std::string &metric, const double value);
+
+        std::map<std::string, double> getMetrics() const;
+
+        bool writeChromeTrace(const std::string &path) const;
+
+        /**
+         * Writes the metrics as a flat JSON object.
+         */
+        bool writeMetrics(const std::string &path) const;
+
+        static Trace& getDefault();
+
+    private:
+        struct Event {
+            std::string name;
+            std::string category;
+            std::int64_t start;         // microseconds since the trace was created
+            std::int64_t duration;
+            int lane;
+            std::map<std::string, std::string> args;
+        };
+
+        void addEvent(Event event);
+
+        std::int64_t toMicroseconds(const std::chrono::steady_clock::time_point time) const;
+
+        static int currentLane();
+
+    private:
+        bool enabled = false;
+        std::chrono::steady_clock::time_point origin;
+
+        mutable std::mutex mutex;
+        std::vector<Event> events;
+        std::map<std::string, double> metrics;
+    };
+}
@@ -0,0 +1,36 @@
+
+#pragma once 
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    struct UnityBatch {
+        std::string name;       // stable across builds, for the name of its unity file
+        std::vector<std::string> sources;
+    };
+
+
+    /**
+     * Splits 'sources' into batches of at most 'maxBatchSize', to be compiled as unity (jumbo) translation units.
+     * 
+     * Every source lands in the bucket selected by a hash of its path, so adding, removing or editing a 
+     * source only disturbs its own bucket, as long as the number of buckets stays the same. That number 
+     * depends on nothing but the sources: 'bucketCount' is the one used last time (0 when there's none), 
+     * and is only changed (to fill buckets about halfway) when buckets would hold more than 'maxBatchSize' 
+     * sources on average, or less than a quarter of it. A bucket that still overflows is split in sorted 
+     * order, which only disturbs that bucket. Empty batches are dropped.
+     * 
+     * So that 'jobSlots' compiles can run at once, buckets are also split when there are fewer of them than 
+     * slots, each into as many parts as it takes (of two sources at least). Changing the number of slots 
+     * changes those splits, but never which bucket a source is in.
+     */
+    std::vector<UnityBatch> planUnityBatches(const std::vector<std::string> &sources, const std::size_t maxBatchSize, const std::size_t jobSlots, std::size_t &bucketCount);
+
+    /**
+     * Contents of the unity file 'unityFile', including each one of 'sources'.
+     */
+    std::string makeUnitySource(const std::string &unityFile, const std::vector<std::string> &sources);
+}
@@ -0,0 +1,75 @@
+
+#pragma once 
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Command.hpp"
+#include "WorkerProtocol.hpp"
+
+
+namespace bok {
+    class Compiler;
+    struct CompileOutput;
+
+    /**
+     * Hands compiles out to compile workers (see CompileWorker), the way distcc does: sources are 
+     * preprocessed locally, and the preprocessed source and the command line are shipped to the least 
+     * loaded worker, which sends the object back.
+     * 
+     * A compile falls back to the local machine whenever it can't be distributed, every worker is busy, 
+     * or the chosen one can't be reached or doesn't answer in time. A worker that failed is left alone 
+     * for a while.
+     */
+    class WorkerPool {
+    public:
+        explicit WorkerPool(const std::vector<WorkerEndpoint> &endpoints, const Compiler *compiler);
+
+        /**
+         * How long a worker can take to compile a source before it's compiled locally instead.
+         */
+        void setTimeout(const std::chrono::milliseconds timeout) {
+            this->timeout = timeout;
+        }
+
+        /**
+         * Asks every worker for its job limit. Returns the total, over the workers that answered.
+         */
+        std::size_t probe();
+
+        /**
+         * Compiles 'output' on a worker, and writes its object and depfile. Returns nothing when it has 
+         * to be compiled locally instead; otherwise, the result of the compile, successful or not.
+         */
+        std::optional<ProcessResult> compile(const CompileOutput &output);
+
+    private:
+        struct Worker {
+            WorkerEndpoint endpoint;
+            std::uint32_t jobLimit = 0;
+            std::uint32_t reportedLoad = 0;
+            std::uint32_t inflight = 0;
+            std::chrono::steady_clock::time_point retryAfter;
+        };
+
+        Worker* acquireWorker();
+
+        void releaseWorker(Worker *worker, const bool failed, const std::optional<std::uint32_t> load = {});
+
+        std::optional<ProcessResult> compileOn(Worker &worker, const std::vector<std::string> &command, const std::string &input, const std::string &objectFile);
+
+    private:
+        const Compiler *compiler = nullptr;
+        std::chrono::milliseconds timeout {60000};
+
+        std::mutex mutex;
+        std::vector<Worker> workers;
+        std::atomic<bool> probed = false;
+        std::once_flag probeOnce;
+    };
+}
@@ -0,0 +1,163 @@
+
+#pragma once 
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace bok {
+    /**
+     * Where a compile worker listens: "unix:<path>" for a Unix socket, or "tcp:<host>:<port>".
+     */
+    struct WorkerEndpoint {
+        enum class Kind {
+            Unix,
+            Tcp
+        };
+
+        Kind kind = Kind::Unix;
+        std::string path;
+        std::string host;
+        std::uint16_t port = 0;
+
+        /**
+         * Parses an endpoint. Throws when it's malformed.
+         */
+        static WorkerEndpoint parse(const std::string &value);
+
+        std::string toString() const;
+    };
+
+
+    /**
+     * Starts listening on 'endpoint'. Throws when it can't.
+     */
+    int listenOn(const WorkerEndpoint &endpoint);
+
+    /**
+     * Connects to 'endpoint', giving up after 'timeout'. Returns -1 when it can't.
+     */
+    int connectTo(const WorkerEndpoint &endpoint, const std::chrono::milliseconds timeout);
+
+    /**
+     * Makes reads and writes on 'fd' fail after 'timeout' without progress.
+     */
+    void setSocketTimeout(const int fd, const std::chrono::milliseconds timeout);
+
+
+    /**
+     * Every message is a 32-bit length followed by that many bytes. Returns false when the peer went away.
+     */
+    bool sendMessage(const int fd, const std::string &payload);
+
+    /**
+     * Receives a whole message. Returns nothing when the peer went away or sent something too large.
+     */
+    std::optional<std::string> receiveMessage(const int fd);
+
+
+    enum class WorkerRequest : std::uint8_t {
+        Status = 1,
+        Compile = 2
+    };
+
+
+    /**
+     * Builds the payload of a message.
+     */
+    class WireWriter {
+    public:
+        template<typename Value>
+        WireWriter& put(const Value value) {
+            data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+
+            return *this;
+        }
+
+        WireWriter& put(const std::string &value) {
+            this->put(static_cast<std::uint32_t>(value.size()));
+            data.append(value);
+
+            return *this;
+        }
+
+        WireWriter& put(const std::vector<std::string> &values) {
+            this->put(static_cast<std::uint32_t>(values.size()));
+
+            for (const std::string &value : values) {
+                this->put(value);
+            }
+
+            return *this;
+        }
+
+        const std::string& getData() const {
+            return data;
+        }
+
+    private:
+        std::string data;
+    };
+
+
+    /**
+     * Reads back what a WireWriter wrote. Every read fails once the payload runs out.
+     */
+    class WireReader {
+    public:
+        explicit WireReader(const std::string &data) 
+            : data(data) {}
+
+        template<typename Value>
+        bool get(Value &value) {
+            if (sizeof(value) > data.size() - offset) {
+                return false;
+            }
+
+            std::memcpy(&value, data.data() + offset, sizeof(value));
+            offset += sizeof(value);
+
+            return true;
+        }
+
+        bool get(std::string &value) {
+            std::uint32_t size = 0;
+
+            if (! this->get(size) || size > data.size() - offset) {
+                return false;
+            }
+
+            value = data.substr(offset, size);
+            offset += size;
+
+            return true;
+        }
+
+        bool get(std::vector<std::string> &values) {
+            std::uint32_t count = 0;
+
+            if (! this->get(count) || count > data.size() - offset) {
+                return false;
+            }
+
+            values.resize(count);
+
+            for (std::string &value : values) {
+                if (! this->get(value)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        const std::string &data;
+        std::size_t offset = 0;
+    };
+}
@@ -1,142 +1,823 @@
 
 #include <bok/core/BuildCache.hpp>
 
-#include <iostream>
-#include <sys/types.h>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <bok/core/Hash.hpp>
+#include <bok/core/Log.hpp>
+#include <bok/core/Trace.hpp>
 
 
 namespace bok {
+    namespace {
+        constexpr char SNAPSHOT_MAGIC[8] = {'B', 'O', 'K', 'C', 'A', 'C', 'H', 'E'};
+        constexpr std::uint32_t SNAPSHOT_VERSION = 4;
+
+        // journal batches are written once they grow past this size, or get this old
+        constexpr std::size_t COMMIT_SIZE = 64 * 1024;
+        constexpr auto COMMIT_INTERVAL = std::chrono::milliseconds(100);
+
+        struct FileStateRecord {
+            std::int64_t modifiedTime;
+            std::uint64_t size;
+            std::uint64_t inode;
+            std::uint64_t contentHash;
+        };
+
+        struct SnapshotHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t sourceCount;
+            std::uint32_t dependencyCount;
+            std::uint32_t reserved;
+            std::uint64_t stringTableSize;
+        };
+
+        struct SourceRecord {
+            std::uint64_t pathOffset;
+            std::uint32_t pathLength;
+            std::uint32_t firstDependency;
+            std::uint32_t dependencyCount;
+            std::uint32_t reserved;
+            std::uint64_t commandHash;
+            std::uint64_t peakMemory;
+            std::uint64_t cpuTime;
+            std::uint32_t durations[BuildCache::DURATION_HISTORY];
+            FileStateRecord state;
+        };
+
+        struct DependencyRecord {
+            std::uint64_t pathOffset;
+            std::uint32_t pathLength;
+            std::uint32_t reserved;
+            FileStateRecord state;
+        };
+
+        FileStateRecord toRecord(const FileState &state) {
+            return {state.modifiedTime, state.size, state.inode, state.contentHash};
+        }
+
+        FileState fromRecord(const FileStateRecord &record) {
+            return {record.modifiedTime, record.size, record.inode, record.contentHash};
+        }
+
+        template<typename T>
+        void put(std::string &buffer, const T &value) {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void putString(std::string &buffer, const std::string &value) {
+            put(buffer, static_cast<std::uint32_t>(value.size()));
+            buffer.append(value);
+        }
+
+        /**
+         * Bounds-checked reader for journal records.
+         */
+        struct Reader {
+            const char *ptr;
+            const char *end;
+
+            template<typename T>
+            bool get(T &value) {
+                if (static_cast<std::size_t>(end - ptr) < sizeof(T)) {
+                    return false;
+                }
+
+                std::memcpy(&value, ptr, sizeof(T));
+                ptr += sizeof(T);
+
+                return true;
+            }
+
+            bool getString(std::string &value) {
+                std::uint32_t length;
+
+                if (! get(length) || static_cast<std::size_t>(end - ptr) < length) {
+                    return false;
+                }
+
+                value.assign(ptr, length);
+                ptr += length;
+
+                return true;
+            }
+        };
+
+        bool writeAll(const int fd, const char *data, std::size_t size) {
+            while (size > 0) {
+                const ssize_t written = ::write(fd, data, size);
+
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    return false;
+                }
+
+                data += written;
+                size -= static_cast<std::size_t>(written);
+            }
+
+            return true;
+        }
+    }
+
+
     BuildCache::BuildCache(const std::string &cacheFile) {
         this->cacheFile = cacheFile;
+        this->journalFile = cacheFile + ".journal";
         this->loadCache();
 
-        fsOutput.open (cacheFile.c_str(), std::ios_base::out);
-        if (! fsOutput.is_open()) {
-            return;
-        }
+        journalFd = ::open(journalFile.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        lastCommit = std::chrono::steady_clock::now();
     }
 
 
     BuildCache::~BuildCache() {
-        this->saveCache();
+        this->compact();
+
+        if (journalFd >= 0) {
+            ::close(journalFd);
+        }
+
+        this->unmapSnapshot();
+    }
+
+
+    void BuildCache::sourceBuilt(const std::string &sourceFile, const std::string &commandLine, const std::vector<std::string> &dependencies, const ResourceUsage &usage) {
+        this->recordEntry(sourceFile, hashString(commandLine), dependencies, usage);
+    }
+
+
+    bool BuildCache::sourceNeedsRebuild(const std::string &sourceFile, const std::string &commandLine) {
+        return this->entryNeedsRebuild(sourceFile, hashString(commandLine), nullptr);
+    }
+
+
+    void BuildCache::linkBuilt(const std::string &outputFile, const std::string &commandLine, const std::vector<std::string> &inputs, const ResourceUsage &usage) {
+        fileStates.invalidate(outputFile);
+        this->recordEntry(outputFile, hashString(commandLine), inputs, usage);
+    }
+
+
+    bool BuildCache::linkNeedsRebuild(const std::string &outputFile, const std::string &commandLine, const std::vector<std::string> &inputs) {
+        return this->entryNeedsRebuild(outputFile, hashString(commandLine), &inputs);
+    }
+
+
+    std::optional<ResourceUsage> BuildCache::getResourceUsage(const std::string &file) const {
+        const std::optional<ActionHistory> history = this->getHistory(file);
+
+        if (! history || !history->usage.isKnown()) {
+            return {};
+        }
+
+        return history->usage;
+    }
+
+
+    std::optional<BuildCache::ActionHistory> BuildCache::getHistory(const std::string &file) const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (auto it = sourceCache.find(file); it != sourceCache.end()) {
+            return toHistory(it->second);
+        }
+
+        if (const auto entry = this->findSnapshotEntry(file, false)) {
+            return toHistory(*entry);
+        }
+
+        return {};
+    }
+
+
+    std::map<std::string, BuildCache::ActionHistory> BuildCache::getHistories() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::map<std::string, ActionHistory> histories;
+
+        if (snapshotData) {
+            const auto header = reinterpret_cast<const SnapshotHeader*>(snapshotData);
+            const auto sources = reinterpret_cast<const SourceRecord*>(header + 1);
+            const auto dependencies = reinterpret_cast<const DependencyRecord*>(sources + header->sourceCount);
+            const auto strings = reinterpret_cast<const char*>(dependencies + header->dependencyCount);
+
+            for (std::uint32_t i = 0; i < header->sourceCount; i++) {
+                const std::string file {strings + sources[i].pathOffset, sources[i].pathLength};
+
+                if (const auto entry = this->findSnapshotEntry(file, false)) {
+                    histories[file] = toHistory(*entry);
+                }
+            }
+        }
+
+        for (const auto &pair : sourceCache) {
+            histories[pair.first] = toHistory(pair.second);
+        }
+
+        return histories;
+    }
+
+
+    BuildCache::ActionHistory BuildCache::toHistory(const CacheEntry &entry) {
+        ActionHistory history;
+        history.usage = entry.usage;
+
+        for (const std::uint32_t duration : entry.durations) {
+            if (duration == 0) {
+                break;
+            }
+
+            history.durations.push_back(std::chrono::microseconds{duration});
+        }
+
+        if (! history.durations.empty()) {
+            history.usage.wallTime = static_cast<std::uint64_t>(history.durations.front().count());
+        }
+
+        return history;
+    }
+
+
+    void BuildCache::recordEntry(const std::string &file, const std::uint64_t commandHash, const std::vector<std::string> &dependencies, const ResourceUsage &usage) {
+        const std::optional<FileState> state = fileStates.scan(file);
+
+        if (! state) {
+            throw std::runtime_error("The file '" + file + "' disappeared during the build");
+        }
+
+        CacheEntry entry;
+        entry.state = *state;
+        entry.commandHash = commandHash;
+        entry.usage = usage;
+
+        const auto normalFile = std::filesystem::path(file).lexically_normal();
+
+        for (const std::string &dependency : dependencies) {
+            if (std::filesystem::path(dependency).lexically_normal() == normalFile) {
+                continue;
+            }
+
+            // a dependency that vanished is recorded as such, and will trigger a rebuild later
+            entry.dependencies.push_back({dependency, fileStates.scan(dependency).value_or(FileState{})});
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            const CacheEntry *previous = nullptr;
+            std::optional<CacheEntry> snapshotEntry;
+
+            if (auto it = sourceCache.find(file); it != sourceCache.end()) {
+                previous = &it->second;
+            } else if (snapshotEntry = this->findSnapshotEntry(file, false); snapshotEntry) {
+                previous = &snapshotEntry.value();
+            }
+
+            if (previous) {
+                // like an object restored from the object cache: the last compile is still the best estimate
+                if (! usage.isKnown()) {
+                    entry.usage.peakMemory = previous->usage.peakMemory;
+                    entry.usage.cpuTime = previous->usage.cpuTime;
+                }
+
+                entry.durations = previous->durations;
+            }
+
+            if (usage.wallTime > 0) {
+                std::copy_backward(entry.durations.begin(), entry.durations.end() - 1, entry.durations.end());
+                entry.durations[0] = static_cast<std::uint32_t>(std::min<std::uint64_t>(usage.wallTime, std::numeric_limits<std::uint32_t>::max()));
+            }
+
+            this->appendEntryToCache(file, entry);
+
+            sourceCache[file] = std::move(entry);
+        }
+
+        this->commit(false);
+    }
+
+
+    bool BuildCache::entryNeedsRebuild(const std::string &file, const std::uint64_t commandHash, const std::vector<std::string> *inputs) {
+        bool refreshed = false;
+        bool changed = false;
+
+        // disabled unless debugging, in which case the records are formatted but never written here
+        Log &log = Log::getDefault();
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            CacheEntry *entry = nullptr;
+            std::optional<CacheEntry> snapshotEntry;
+
+            if (auto it = sourceCache.find(file); it != sourceCache.end()) {
+                entry = &it->second;
+            } else if (snapshotEntry = this->findSnapshotEntry(file); snapshotEntry) {
+                entry = &snapshotEntry.value();
+            } else {
+                log.print(LogLevel::Debug, file, ": out of date (not in the cache)");
+                return true;
+            }
+
+            if (commandHash != entry->commandHash) {
+                log.print(LogLevel::Debug, file, ": out of date (command changed)");
+                return true;
+            }
+
+            if (inputs) {
+                const bool sameInputs = inputs->size() == entry->dependencies.size() && std::equal(inputs->begin(), inputs->end(), entry->dependencies.begin(), [] (const std::string &input, const auto &dependency) {
+                    return input == dependency.first;
+                });
+
+                if (! sameInputs) {
+                    log.print(LogLevel::Debug, file, ": out of date (inputs changed)");
+                    return true;
+                }
+            }
+
+            changed = this->fileChanged(file, entry->state, refreshed);
+
+            if (changed) {
+                log.print(LogLevel::Debug, file, ": out of date (changed)");
+            }
+
+            for (auto &dependency : entry->dependencies) {
+                if (changed) {
+                    break;
+                }
+
+                if (this->fileChanged(dependency.first, dependency.second, refreshed)) {
+                    log.print(LogLevel::Debug, file, ": out of date (", dependency.first, " changed)");
+                    changed = true;
+                }
+            }
+
+            if (! changed) {
+                log.print(LogLevel::Debug, file, ": up to date");
+            }
+
+            if (refreshed && !changed) {
+                this->appendEntryToCache(file, *entry);
+
+                if (snapshotEntry) {
+                    sourceCache[file] = std::move(*snapshotEntry);
+                }
+            }
+        }
+
+        if (refreshed && !changed) {
+            this->commit(false);
+        }
+
+        return changed;
+    }
+
+
+    void BuildCache::startBuild() {
+        if (! residentFileStates) {
+            fileStates.clear();
+        }
+    }
+
+
+    void BuildCache::prefetchFileStates(const std::vector<std::string> &files, JobScheduler *scheduler) {
+        std::vector<std::string> paths = files;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            for (const std::string &file : files) {
+                if (auto it = sourceCache.find(file); it != sourceCache.end()) {
+                    for (const auto &dependency : it->second.dependencies) {
+                        paths.push_back(dependency.first);
+                    }
+                } else if (const auto entry = this->findSnapshotEntry(file)) {
+                    for (const auto &dependency : entry->dependencies) {
+                        paths.push_back(dependency.first);
+                    }
+                }
+            }
+        }
+
+        fileStates.prefetch(paths, scheduler);
+    }
+
+
+    void BuildCache::fileWritten(const std::string &file) {
+        fileStates.invalidate(file);
     }
 
 
-    void BuildCache::sourceBuilt(const std::string &sourceFile) {
-        const time_t modifiedTime = this->getModifiedTime(sourceFile.c_str(), DL_FILESYSTEM).value();
+    void BuildCache::setResidentFileStates(const bool resident) {
+        residentFileStates = resident;
+        fileStates.clear();
+    }
+
+
+    std::vector<std::string> BuildCache::refreshFileStates(const std::vector<std::string> &files) {
+        if (! residentFileStates) {
+            return {};
+        }
+
+        return fileStates.refresh(files);
+    }
+
+
+    void BuildCache::forgetFileStates() {
+        fileStates.clear();
+    }
 
-        sourceCache.insert({sourceFile, modifiedTime});
 
-        this->appendEntryToCache(sourceFile, modifiedTime);
+    std::vector<std::string> BuildCache::getResidentFiles() const {
+        return fileStates.getPaths();
     }
 
 
-    bool BuildCache::sourceNeedsRebuild(const std::string &sourceFile) const {
-        std::cout << "Cheking " << sourceFile << std::endl;
+    bool BuildCache::fileChanged(const std::string &fileName, FileState &recordedState, bool &refreshed) {
+        const auto currentState = fileStates.stat(fileName);
 
-        const auto cachedTimestamp = this->getModifiedTime(sourceFile.c_str(), DL_CACHE);
-        const auto currentTimestamp = this->getModifiedTime(sourceFile.c_str(), DL_FILESYSTEM);
+        if (! currentState) {
+            return true;
+        }
 
-        if (!cachedTimestamp.has_value() || !currentTimestamp.has_value()) {
-            std::cout << "Must build (HARD): " << true << std::endl;
-            std::cout << "    cachedTimestamp: " << cachedTimestamp.has_value() << std::endl;
-            std::cout << "    currentTimestamp: " << currentTimestamp.has_value() << std::endl;
+        if (currentState->sameStat(recordedState)) {
+            return false;
+        }
 
+        // touched, checked out again, or edited within the same timestamp: let the content decide
+        const auto scannedState = fileStates.scan(fileName);
+
+        if (! scannedState || scannedState->contentHash != recordedState.contentHash) {
             return true;
         }
 
-        std::cout << "Must build: " << (cachedTimestamp.value() != currentTimestamp.value()) << std::endl;
-        return cachedTimestamp.value() != currentTimestamp.value();
+        recordedState = *scannedState;
+        refreshed = true;
+
+        return false;
     }
 
 
     void BuildCache::loadCache() {
-        std::fstream fs(cacheFile.c_str(), std::ios_base::in);
+        Trace::Scope scope {Trace::getDefault(), "BuildCache::load", "cache"};
 
-        if (! fs.is_open()) {
+        this->mapSnapshot();
+        this->replayJournal();
+
+        if (snapshotData) {
+            scope.setArg("snapshotEntries", reinterpret_cast<const SnapshotHeader*>(snapshotData)->sourceCount);
+        }
+
+        scope.setArg("journalEntries", static_cast<std::int64_t>(sourceCache.size()));
+    }
+
+
+    void BuildCache::mapSnapshot() {
+        const int fd = ::open(cacheFile.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) {
             return;
         }
 
-        std::string line;
+        struct stat info;
 
-        while (!fs.eof()) {
-            std::getline(fs, line);
+        if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+            ::close(fd);
+            return;
+        }
 
-            std::cout << "Parsing line: " << line << std::endl;
+        void *data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
 
-            size_t pos = line.find(':');
+        if (data == MAP_FAILED) {
+            return;
+        }
 
-            if (pos == std::string::npos) {
-                std::cout << "    Separator not found: " << line << std::endl;
-                continue;
+        const auto header = static_cast<const SnapshotHeader*>(data);
+        const std::size_t expectedSize = sizeof(SnapshotHeader) 
+            + header->sourceCount * sizeof(SourceRecord) 
+            + header->dependencyCount * sizeof(DependencyRecord) 
+            + header->stringTableSize;
+
+        if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 
+            || header->version != SNAPSHOT_VERSION 
+            || expectedSize != static_cast<std::size_t>(info.st_size)) {
+            // unknown or foreign format: start from scratch
+            ::munmap(data, static_cast<std::size_t>(info.st_size));
+            return;
+        }
+
+        snapshotData = static_cast<const char*>(data);
+        snapshotSize = static_cast<std::size_t>(info.st_size);
+    }
+
+
+    void BuildCache::unmapSnapshot() {
+        if (snapshotData) {
+            ::munmap(const_cast<char*>(snapshotData), snapshotSize);
+        }
+
+        snapshotData = nullptr;
+        snapshotSize = 0;
+    }
+
+
+    std::optional<BuildCache::CacheEntry> BuildCache::findSnapshotEntry(const std::string &sourceFile, const bool withDependencies) const {
+        if (! snapshotData) {
+            return {};
+        }
+
+        const auto header = reinterpret_cast<const SnapshotHeader*>(snapshotData);
+        const auto sources = reinterpret_cast<const SourceRecord*>(header + 1);
+        const auto dependencies = reinterpret_cast<const DependencyRecord*>(sources + header->sourceCount);
+        const auto strings = reinterpret_cast<const char*>(dependencies + header->dependencyCount);
+
+        auto pathOf = [&] (const std::uint64_t offset, const std::uint32_t length) {
+            if (offset + length > header->stringTableSize) {
+                return std::string_view{};
             }
 
-            const std::string key = line.substr(0, pos);
-            const std::string value_str = line.substr(pos + 1, line.size());
-            const time_t value = static_cast<time_t>(std::atol(line.substr(pos + 1, line.size()).c_str()));
-            const long long_value = std::atol(line.substr(pos + 1, line.size()).c_str());
+            return std::string_view{strings + offset, length};
+        };
 
-            std::cout << "    key: " << key << std::endl;
-            std::cout << "    value_str: " << value_str << std::endl;
-            std::cout << "    value: " << value << std::endl;
-            std::cout << "    long_value: " << long_value << std::endl;
+        const auto it = std::lower_bound(sources, sources + header->sourceCount, std::string_view{sourceFile}, [&] (const SourceRecord &record, std::string_view key) {
+            return pathOf(record.pathOffset, record.pathLength) < key;
+        });
 
-            sourceCache.insert({key, value});
+        if (it == sources + header->sourceCount || pathOf(it->pathOffset, it->pathLength) != sourceFile) {
+            return {};
         }
 
-        // 
-        std::cout << "Loaded cache: " << std::endl;
-        for (const auto &pair : sourceCache) {
-            std::cout << "    " << "\"" << pair.first << "\":" << pair.second << std::endl;
+        CacheEntry entry;
+        entry.state = fromRecord(it->state);
+        entry.commandHash = it->commandHash;
+        entry.usage = {it->peakMemory, it->cpuTime};
+        std::copy(it->durations, it->durations + DURATION_HISTORY, entry.durations.begin());
+
+        if (! withDependencies) {
+            return entry;
+        }
+
+        if (it->firstDependency + it->dependencyCount > header->dependencyCount) {
+            return {};
         }
+
+        for (std::uint32_t i = 0; i < it->dependencyCount; i++) {
+            const DependencyRecord &dependency = dependencies[it->firstDependency + i];
+
+            entry.dependencies.push_back({std::string{pathOf(dependency.pathOffset, dependency.pathLength)}, fromRecord(dependency.state)});
+        }
+
+        return entry;
     }
 
 
-    void BuildCache::saveCache() {
-        std::fstream fs {cacheFile.c_str(), std::ios_base::out};
+    void BuildCache::replayJournal() {
+        const int fd = ::open(journalFile.c_str(), O_RDONLY | O_CLOEXEC);
 
-        if (! fs.is_open()) {
+        if (fd < 0) {
             return;
         }
 
-        for (const auto &pair : sourceCache) {
-            fs << pair.first << ":" << pair.second << std::endl;
+        std::string content;
+        char buffer[65536];
+        ssize_t count;
+
+        while ((count = ::read(fd, buffer, sizeof(buffer))) > 0) {
+            content.append(buffer, static_cast<std::size_t>(count));
+        }
+
+        ::close(fd);
+
+        Reader reader {content.data(), content.data() + content.size()};
+
+        while (reader.ptr != reader.end) {
+            std::uint32_t payloadSize;
+            std::uint64_t checksum;
+
+            if (! reader.get(payloadSize) || ! reader.get(checksum) || static_cast<std::size_t>(reader.end - reader.ptr) < payloadSize) {
+                break;
+            }
+
+            if (hashBytes(reader.ptr, payloadSize, SNAPSHOT_VERSION) != checksum) {
+                // torn write from an interrupted build: everything after it is unreliable
+                break;
+            }
+
+            Reader payload {reader.ptr, reader.ptr + payloadSize};
+            reader.ptr += payloadSize;
+
+            std::string sourceFile;
+            CacheEntry entry;
+            FileStateRecord state;
+            std::uint32_t dependencyCount;
+
+            if (! payload.getString(sourceFile) || ! payload.get(state) || ! payload.get(entry.commandHash) 
+                || ! payload.get(entry.usage.peakMemory) || ! payload.get(entry.usage.cpuTime) || ! payload.get(entry.durations) || ! payload.get(dependencyCount)) {
+                break;
+            }
+
+            entry.state = fromRecord(state);
+
+            for (std::uint32_t i = 0; i < dependencyCount; i++) {
+                std::string dependency;
+
+                if (! payload.getString(dependency) || ! payload.get(state)) {
+                    break;
+                }
+
+                entry.dependencies.push_back({dependency, fromRecord(state)});
+            }
+
+            sourceCache[sourceFile] = std::move(entry);
         }
     }
 
 
-    void BuildCache::appendEntryToCache(const std::string &sourceFile, const time_t modifiedTime) {
-        // std::cout << "appendEntryToCache: " << sourceFile << ":" << modifiedTime << std::endl;
+    void BuildCache::appendEntryToCache(const std::string &sourceFile, const CacheEntry &entry) {
+        std::string payload;
+
+        putString(payload, sourceFile);
+        put(payload, toRecord(entry.state));
+        put(payload, entry.commandHash);
+        put(payload, entry.usage.peakMemory);
+        put(payload, entry.usage.cpuTime);
+        put(payload, entry.durations);
+        put(payload, static_cast<std::uint32_t>(entry.dependencies.size()));
+
+        for (const auto &dependency : entry.dependencies) {
+            putString(payload, dependency.first);
+            put(payload, toRecord(dependency.second));
+        }
+
+        put(pendingJournal, static_cast<std::uint32_t>(payload.size()));
 
-        fsOutput  << sourceFile << ":" << modifiedTime << std::endl;
-        fsOutput.flush();
+        // seeded with the format version, so records from older formats fail the check
+        put(pendingJournal, hashBytes(payload.data(), payload.size(), SNAPSHOT_VERSION));
+        pendingJournal += payload;
     }
 
 
-    std::optional<time_t> BuildCache::getModifiedTime(const char *fileName, DATA_LOCATION location) const {
-        switch (location) {
-            case DL_CACHE: {
-                if (auto it = sourceCache.find(fileName); it != sourceCache.end()) {
-                    return it->second;
-                }
+    void BuildCache::commit() {
+        this->commit(true);
+    }
 
-                break;
+
+    void BuildCache::commit(const bool force) {
+        // a single writer at a time: entries appended meanwhile ride along the next batch
+        std::unique_lock<std::mutex> commitLock{commitMutex, std::defer_lock};
+
+        if (force) {
+            commitLock.lock();
+        } else if (! commitLock.try_lock()) {
+            return;
+        }
+
+        std::string batch;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            const auto now = std::chrono::steady_clock::now();
+
+            if (pendingJournal.empty() || (!force && pendingJournal.size() < COMMIT_SIZE && now - lastCommit < COMMIT_INTERVAL)) {
+                return;
             }
 
-            case DL_FILESYSTEM: {
-                struct stat result;
+            batch.swap(pendingJournal);
+            lastCommit = now;
+        }
 
-                if (stat(fileName, &result) == 0) {
-                    auto modified_time = result.st_mtim;
+        if (journalFd >= 0) {
+            writeAll(journalFd, batch.data(), batch.size());
+        }
+    }
+
+
+    void BuildCache::compact() {
+        Trace::Scope scope {Trace::getDefault(), "BuildCache::compact", "cache"};
+
+        // journaled first: should the snapshot fail to be written, the next build still finds them
+        this->commit(true);
+
+        std::lock_guard<std::mutex> commitLock{commitMutex};
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (sourceCache.empty() && snapshotData) {
+            // nothing new since the snapshot was written
+            return;
+        }
+
+        // gather every live entry, sorted by path
+        std::map<std::string, CacheEntry> entries;
 
-                    return modified_time.tv_sec;
+        if (snapshotData) {
+            const auto header = reinterpret_cast<const SnapshotHeader*>(snapshotData);
+            const auto sources = reinterpret_cast<const SourceRecord*>(header + 1);
+            const auto dependencies = reinterpret_cast<const DependencyRecord*>(sources + header->sourceCount);
+            const auto strings = reinterpret_cast<const char*>(dependencies + header->dependencyCount);
+
+            for (std::uint32_t i = 0; i < header->sourceCount; i++) {
+                std::string sourceFile {strings + sources[i].pathOffset, sources[i].pathLength};
+
+                if (sourceCache.find(sourceFile) == sourceCache.end()) {
+                    entries[sourceFile] = this->findSnapshotEntry(sourceFile).value_or(CacheEntry{});
                 }
+            }
+        }
 
-                break;
+        // copied, as they're still needed if the snapshot can't be written
+        for (const auto &pair : sourceCache) {
+            entries[pair.first] = pair.second;
+        }
+
+        std::vector<SourceRecord> sourceRecords;
+        std::vector<DependencyRecord> dependencyRecords;
+        std::string strings;
+        std::unordered_map<std::string, std::uint64_t> stringOffsets;
+
+        auto intern = [&] (const std::string &value) {
+            auto [it, inserted] = stringOffsets.insert({value, strings.size()});
+
+            if (inserted) {
+                strings += value;
+            }
+
+            return it->second;
+        };
+
+        for (const auto &pair : entries) {
+            SourceRecord record {};
+            record.pathOffset = intern(pair.first);
+            record.pathLength = static_cast<std::uint32_t>(pair.first.size());
+            record.firstDependency = static_cast<std::uint32_t>(dependencyRecords.size());
+            record.dependencyCount = static_cast<std::uint32_t>(pair.second.dependencies.size());
+            record.commandHash = pair.second.commandHash;
+            record.peakMemory = pair.second.usage.peakMemory;
+            record.cpuTime = pair.second.usage.cpuTime;
+            std::copy(pair.second.durations.begin(), pair.second.durations.end(), record.durations);
+            record.state = toRecord(pair.second.state);
+
+            sourceRecords.push_back(record);
+
+            for (const auto &dependency : pair.second.dependencies) {
+                DependencyRecord dependencyRecord {};
+                dependencyRecord.pathOffset = intern(dependency.first);
+                dependencyRecord.pathLength = static_cast<std::uint32_t>(dependency.first.size());
+                dependencyRecord.state = toRecord(dependency.second);
+
+                dependencyRecords.push_back(dependencyRecord);
             }
         }
 
-        return {};
+        SnapshotHeader header {};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.sourceCount = static_cast<std::uint32_t>(sourceRecords.size());
+        header.dependencyCount = static_cast<std::uint32_t>(dependencyRecords.size());
+        header.stringTableSize = strings.size();
+
+        // write aside, then atomically replace the previous snapshot
+        const std::string temporaryFile = cacheFile + ".tmp";
+        const int fd = ::open(temporaryFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (fd < 0) {
+            return;
+        }
+
+        const bool written = writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header))
+            && writeAll(fd, reinterpret_cast<const char*>(sourceRecords.data()), sourceRecords.size() * sizeof(SourceRecord))
+            && writeAll(fd, reinterpret_cast<const char*>(dependencyRecords.data()), dependencyRecords.size() * sizeof(DependencyRecord))
+            && writeAll(fd, strings.data(), strings.size())
+            && ::fdatasync(fd) == 0;
+
+        ::close(fd);
+
+        if (! written || ::rename(temporaryFile.c_str(), cacheFile.c_str()) != 0) {
+            ::unlink(temporaryFile.c_str());
+            return;
+        }
+
+        // the journal is now redundant; replaying it again would be harmless anyway
+        sourceCache.clear();
+        pendingJournal.clear();
+
+        if (journalFd >= 0) {
+            ::ftruncate(journalFd, 0);
+        }
+
+        this->unmapSnapshot();
+        this->mapSnapshot();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,55 @@
+
+#include <bok/core/BuildConfiguration.hpp>
+
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+
+
+namespace bok {
+    namespace {
+        const std::map<std::string, std::vector<std::string>> PREDEFINED_FLAGS = {
+            {"debug", {"-O0", "-g"}},
+            {"release", {"-O2", "-DNDEBUG"}},
+            {"relwithdebinfo", {"-O2", "-g", "-DNDEBUG"}},
+            {"minsizerel", {"-Os", "-DNDEBUG"}}
+        };
+    }
+
+
+    BuildConfiguration::BuildConfiguration() 
+        : BuildConfiguration("debug", "", PREDEFINED_FLAGS.at("debug")) {}
+
+
+    BuildConfiguration::BuildConfiguration(const std::string &name, const std::string &outputDirectory, const std::vector<std::string> &compileFlags, const std::vector<std::string> &linkFlags) {
+        this->name = name;
+        this->outputDirectory = outputDirectory;
+        this->compileFlags = compileFlags;
+        this->linkFlags = linkFlags;
+    }
+
+
+    BuildConfiguration BuildConfiguration::fromName(const std::string &name) {
+        const auto it = PREDEFINED_FLAGS.find(name);
+
+        if (it == PREDEFINED_FLAGS.end()) {
+            throw std::runtime_error("Unknown build configuration '" + name + "'");
+        }
+
+        return BuildConfiguration{name, ".bok/" + name, it->second};
+    }
+
+
+    bool BuildConfiguration::isPredefined(const std::string &name) {
+        return PREDEFINED_FLAGS.find(name) != PREDEFINED_FLAGS.end();
+    }
+
+
+    std::string BuildConfiguration::resolveOutputDirectory(const std::string &packagePath) const {
+        if (outputDirectory.empty()) {
+            return "";
+        }
+
+        return (std::filesystem::path(packagePath) / outputDirectory).lexically_normal().string();
+    }
+}
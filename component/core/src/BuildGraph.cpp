@@ -0,0 +1,147 @@
+
+#include <bok/core/BuildGraph.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace bok {
+    ActionId BuildGraph::addCompile(const Component *component, CompileOutput output, const double cost) {
+        const ActionId action = this->addAction(ActionType::Compile, component, static_cast<std::uint32_t>(compileOutputs.size()), cost, output.objectFile);
+
+        this->addInput(output.sourceFile);
+
+        for (const std::string &dependency : output.implicitDependencies) {
+            this->addInput(dependency);
+        }
+
+        inputOffsets.push_back(static_cast<std::uint32_t>(inputs.size()));
+        compileOutputs.push_back(std::move(output));
+
+        return action;
+    }
+
+
+    ActionId BuildGraph::addLink(const Component *component, LinkerOutput output, const double cost) {
+        const ActionId action = this->addAction(ActionType::Link, component, static_cast<std::uint32_t>(linkerOutputs.size()), cost, output.executable);
+
+        // what links against a shared library waits for the interface file, written after the library
+        if (! output.interfaceFile.empty()) {
+            const PathId interfacePath = paths.intern(output.interfaceFile);
+
+            producers.resize(paths.getPathCount(), NO_ACTION);
+            producers[interfacePath] = action;
+        }
+
+        for (const std::string &input : output.getInputs()) {
+            this->addInput(input);
+
+            if (const ActionId producer = producers[inputs.back()]; producer != NO_ACTION) {
+                this->addEdge(producer, action);
+            }
+        }
+
+        inputOffsets.push_back(static_cast<std::uint32_t>(inputs.size()));
+        linkerOutputs.push_back(std::move(output));
+
+        return action;
+    }
+
+
+    ActionId BuildGraph::addAction(const ActionType type, const Component *component, const std::uint32_t payload, const double cost, std::string_view output) {
+        const auto action = static_cast<ActionId>(types.size());
+        const PathId outputPath = paths.intern(output);
+
+        types.push_back(type);
+        components.push_back(component);
+        payloads.push_back(payload);
+        costs.push_back(cost);
+        criticalPaths.push_back(0.0);
+        dependencyCounts.push_back(0);
+        outputs.push_back(outputPath);
+
+        producers.resize(paths.getPathCount(), NO_ACTION);
+        producers[outputPath] = action;
+
+        return action;
+    }
+
+
+    void BuildGraph::addInput(std::string_view path) {
+        inputs.push_back(paths.intern(path));
+        producers.resize(paths.getPathCount(), NO_ACTION);
+    }
+
+
+    void BuildGraph::addEdge(const ActionId dependency, const ActionId dependent) {
+        edges.emplace_back(dependency, dependent);
+        dependencyCounts[dependent]++;
+    }
+
+
+    std::optional<ActionId> BuildGraph::findProducer(std::string_view path) const {
+        const PathId *id = paths.find(path);
+
+        if (! id || producers[*id] == NO_ACTION) {
+            return {};
+        }
+
+        return producers[*id];
+    }
+
+
+    void BuildGraph::computeCriticalPaths() {
+        const std::size_t actionCount = types.size();
+
+        // counting sort of the edges by their dependency
+        dependentOffsets.assign(actionCount + 1, 0);
+
+        for (const auto &edge : edges) {
+            dependentOffsets[edge.first + 1]++;
+        }
+
+        for (std::size_t i = 0; i < actionCount; i++) {
+            dependentOffsets[i + 1] += dependentOffsets[i];
+        }
+
+        dependentIds.resize(edges.size());
+        std::vector<std::uint32_t> next {dependentOffsets.begin(), dependentOffsets.end() - 1};
+
+        for (const auto &edge : edges) {
+            dependentIds[next[edge.first]++] = edge.second;
+        }
+
+        // Kahn's algorithm, then accumulate the paths in reverse topological order
+        std::vector<std::uint32_t> pending {dependencyCounts};
+        std::vector<ActionId> order;
+        order.reserve(actionCount);
+
+        for (ActionId i = 0; i < actionCount; i++) {
+            if (pending[i] == 0) {
+                order.push_back(i);
+            }
+        }
+
+        for (std::size_t i = 0; i < order.size(); i++) {
+            for (const ActionId dependent : this->getDependents(order[i])) {
+                if (--pending[dependent] == 0) {
+                    order.push_back(dependent);
+                }
+            }
+        }
+
+        if (order.size() != actionCount) {
+            throw std::runtime_error("The build graph has a dependency cycle");
+        }
+
+        for (auto it = order.rbegin(); it != order.rend(); it++) {
+            double longestDependent = 0.0;
+
+            for (const ActionId dependent : this->getDependents(*it)) {
+                longestDependent = std::max(longestDependent, criticalPaths[dependent]);
+            }
+
+            criticalPaths[*it] = costs[*it] + longestDependent;
+        }
+    }
+}
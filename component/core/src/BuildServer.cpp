@@ -0,0 +1,371 @@
+
+#include <bok/core/BuildServer.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <bok/core/BuildCache.hpp>
+#include <bok/core/Log.hpp>
+
+
+namespace bok {
+    namespace {
+        // written to by the signal handler, to wake the server up
+        int signalPipe[2] = {-1, -1};
+
+        void handleSignal(int) {
+            const char byte = 0;
+            [[maybe_unused]] const ssize_t written = ::write(signalPipe[1], &byte, 1);
+        }
+
+
+        bool makeAddress(const std::string &socketPath, sockaddr_un &address) {
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+
+            if (socketPath.size() >= sizeof(address.sun_path)) {
+                return false;
+            }
+
+            std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+            return true;
+        }
+
+
+        int connectTo(const std::string &socketPath) {
+            sockaddr_un address;
+
+            if (! makeAddress(socketPath, address)) {
+                return -1;
+            }
+
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+            if (fd < 0) {
+                return -1;
+            }
+
+            if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+
+            return fd;
+        }
+
+
+        void sendAll(const int fd, const std::string &data) {
+            std::size_t offset = 0;
+
+            while (offset < data.size()) {
+                // a client that went away must not take the server down with a SIGPIPE
+                const ssize_t sent = ::send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+
+                if (sent <= 0) {
+                    return;
+                }
+
+                offset += static_cast<std::size_t>(sent);
+            }
+        }
+
+
+        std::string receiveAll(const int fd, const char terminator = '\0') {
+            std::string data;
+            char buffer[4096];
+
+            while (true) {
+                const ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+
+                if (received <= 0) {
+                    break;
+                }
+
+                data.append(buffer, static_cast<std::size_t>(received));
+
+                if (terminator && data.find(terminator) != std::string::npos) {
+                    break;
+                }
+            }
+
+            return data;
+        }
+
+
+        /**
+         * Sends 'request' and returns the whole response, or nothing when there's no server listening.
+         */
+        std::optional<std::string> sendRequest(const std::string &socketPath, const std::string &request) {
+            const int fd = connectTo(socketPath);
+
+            if (fd < 0) {
+                return {};
+            }
+
+            sendAll(fd, request + "\n");
+            ::shutdown(fd, SHUT_WR);
+
+            const std::string response = receiveAll(fd);
+            ::close(fd);
+
+            return response;
+        }
+    }
+
+
+    BuildServer::BuildServer(const std::string &socketPath, BuildCache *buildCache, BuildFunction buildFunction) {
+        this->socketPath = socketPath;
+        this->buildCache = buildCache;
+        this->buildFunction = buildFunction;
+
+        sockaddr_un address;
+
+        if (! makeAddress(socketPath, address)) {
+            throw std::runtime_error("The socket path '" + socketPath + "' is too long");
+        }
+
+        if (const int fd = connectTo(socketPath); fd >= 0) {
+            ::close(fd);
+            throw std::runtime_error("A build server is already listening on '" + socketPath + "'");
+        }
+
+        // left behind by a server that didn't exit cleanly
+        ::unlink(socketPath.c_str());
+
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        if (listenFd < 0 
+            || ::bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 
+            || ::listen(listenFd, 16) != 0) {
+            const std::string error = std::strerror(errno);
+
+            if (listenFd >= 0) {
+                ::close(listenFd);
+            }
+
+            throw std::runtime_error("Couldn't listen on '" + socketPath + "': " + error);
+        }
+
+        buildCache->setResidentFileStates(true);
+    }
+
+
+    BuildServer::~BuildServer() {
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+
+        buildCache->setResidentFileStates(false);
+    }
+
+
+    void BuildServer::run() {
+        if (::pipe2(signalPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+            throw std::runtime_error("Couldn't create a pipe: " + std::string{std::strerror(errno)});
+        }
+
+        struct sigaction action {};
+        struct sigaction previousInterrupt {};
+        struct sigaction previousTerminate {};
+        action.sa_handler = handleSignal;
+
+        ::sigaction(SIGINT, &action, &previousInterrupt);
+        ::sigaction(SIGTERM, &action, &previousTerminate);
+
+        this->build(std::cout);
+
+        auto lastChange = std::chrono::steady_clock::now();
+        bool stopping = false;
+
+        while (! stopping) {
+            int timeout = -1;
+
+            if (changesPending) {
+                const auto quiet = std::chrono::steady_clock::now() - lastChange;
+                timeout = static_cast<int>(std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(debounce - quiet).count()));
+            }
+
+            pollfd fds[3] = {
+                {watcher.getFd(), POLLIN, 0}, 
+                {listenFd, POLLIN, 0}, 
+                {signalPipe[0], POLLIN, 0}
+            };
+
+            if (::poll(fds, 3, timeout) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                break;
+            }
+
+            if (fds[2].revents) {
+                break;
+            }
+
+            if (fds[0].revents) {
+                if (this->processChanges()) {
+                    lastChange = std::chrono::steady_clock::now();
+                }
+            }
+
+            if (fds[1].revents) {
+                const int clientFd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+
+                if (clientFd >= 0) {
+                    stopping = ! this->serveClient(clientFd);
+                    ::close(clientFd);
+                }
+
+                continue;
+            }
+
+            if (changesPending && std::chrono::steady_clock::now() - lastChange >= debounce) {
+                this->build(std::cout);
+            }
+        }
+
+        ::sigaction(SIGINT, &previousInterrupt, nullptr);
+        ::sigaction(SIGTERM, &previousTerminate, nullptr);
+        ::close(signalPipe[0]);
+        ::close(signalPipe[1]);
+    }
+
+
+    std::optional<int> BuildServer::requestBuild(const std::string &socketPath, std::ostream &output) {
+        const auto response = sendRequest(socketPath, "build");
+
+        if (! response) {
+            return {};
+        }
+
+        // the status comes first, on a line of its own
+        const std::size_t newline = response->find('\n');
+
+        if (newline == std::string::npos) {
+            output << "The build server closed the connection" << std::endl;
+            return 1;
+        }
+
+        output << response->substr(newline + 1) << std::flush;
+
+        return std::atoi(response->substr(0, newline).c_str());
+    }
+
+
+    bool BuildServer::requestStop(const std::string &socketPath) {
+        return sendRequest(socketPath, "stop").has_value();
+    }
+
+
+    bool BuildServer::build(std::ostream &output) {
+        // the files saved right before the request must be part of it
+        this->processChanges();
+        changesPending = false;
+
+        // no events come for these, so they're checked the slow way
+        buildCache->refreshFileStates({polledFiles.begin(), polledFiles.end()});
+
+        const bool succeeded = buildFunction(output);
+
+        this->watchResidentFiles();
+
+        return succeeded;
+    }
+
+
+    void BuildServer::watchResidentFiles() {
+        std::vector<std::string> newFiles;
+
+        for (const std::string &file : buildCache->getResidentFiles()) {
+            if (watcher.isWatching(file)) {
+                continue;
+            }
+
+            const bool wasPolled = polledFiles.count(file) > 0;
+
+            if (watcher.watch(file)) {
+                polledFiles.erase(file);
+                newFiles.push_back(file);
+                continue;
+            }
+
+            if (errno == ENOSPC && !watchLimitReported) {
+                Log::getDefault().print(LogLevel::Warning, "Out of inotify watches (see fs.inotify.max_user_watches): the files that can't be watched are checked before each build instead");
+                watchLimitReported = true;
+            }
+
+            // like when its directory doesn't exist yet, or can't be read
+            if (! wasPolled) {
+                polledFiles.insert(file);
+                newFiles.push_back(file);
+            }
+        }
+
+        // these were stated before being watched, and could have changed in between
+        buildCache->refreshFileStates(newFiles);
+    }
+
+
+    bool BuildServer::processChanges() {
+        bool overflowed = false;
+        const std::vector<std::string> events = watcher.readChanges(overflowed);
+
+        if (overflowed) {
+            buildCache->forgetFileStates();
+        }
+
+        // the build itself writes some of the watched files, like the linked executables, but their 
+        // resident state already reflects that
+        const std::vector<std::string> changes = buildCache->refreshFileStates(events);
+
+        if (overflowed || !changes.empty()) {
+            changesPending = true;
+            return true;
+        }
+
+        return false;
+    }
+
+
+    bool BuildServer::serveClient(const int clientFd) {
+        // a client that connects and goes silent must not stall the server
+        timeval timeout {1, 0};
+        ::setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::string request = receiveAll(clientFd, '\n');
+        request = request.substr(0, request.find('\n'));
+
+        if (request == "build") {
+            std::ostringstream output;
+            const bool succeeded = this->build(output);
+
+            sendAll(clientFd, (succeeded ? "0\n" : "1\n") + output.str());
+        } else if (request == "stop") {
+            sendAll(clientFd, "0\n");
+            return false;
+        } else {
+            sendAll(clientFd, "2\nUnknown request '" + request + "'\n");
+        }
+
+        return true;
+    }
+}
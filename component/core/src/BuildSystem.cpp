@@ -1,56 +1,953 @@
 
 #include <bok/core/BuildSystem.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <set>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <stdexcept>
+#include <bok/core/BuildGraph.hpp>
 #include <bok/core/Compiler.hpp>
 #include <bok/core/Linker.hpp>
 #include <bok/core/BuildCache.hpp>
 #include <bok/core/Component.hpp>
+#include <bok/core/DepFile.hpp>
+#include <bok/core/FileState.hpp>
+#include <bok/core/Glob.hpp>
+#include <bok/core/IncludeScanner.hpp>
+#include <bok/core/JobScheduler.hpp>
+#include <bok/core/Log.hpp>
+#include <bok/core/ObjectCache.hpp>
 #include <bok/core/Package.hpp>
+#include <bok/core/PrefixHeader.hpp>
+#include <bok/core/ResourceBudget.hpp>
+#include <bok/core/Trace.hpp>
+#include <bok/core/UnityBuild.hpp>
+#include <bok/core/WorkerPool.hpp>
 
 
 namespace bok {
-    BuildSystem::BuildSystem(Package *package, BuildCache *buildCache, Listener *listener) {
+    namespace {
+        /**
+         * Removes the repeated values of 'values', keeping the last of each.
+         */
+        std::vector<std::string> keepLastOccurrences(const std::vector<std::string> &values) {
+            std::set<std::string> seen;
+            std::vector<std::string> result;
+
+            for (auto it = values.rbegin(); it != values.rend(); it++) {
+                if (seen.insert(*it).second) {
+                    result.push_back(*it);
+                }
+            }
+
+            std::reverse(result.begin(), result.end());
+
+            return result;
+        }
+
+
+        /**
+         * Whether 'path' is relative and has no "." or ".." parts, so appending it to a normalized directory 
+         * gives a normalized path.
+         */
+        bool isPlainRelativePath(std::string_view path) {
+            if (path.empty() || path.front() == '/') {
+                return false;
+            }
+
+            std::size_t start = 0;
+
+            while (start <= path.size()) {
+                const std::size_t end = std::min(path.find('/', start), path.size());
+                const std::string_view part = path.substr(start, end - start);
+
+                if (part.empty() || part == "." || part == "..") {
+                    return false;
+                }
+
+                start = end + 1;
+            }
+
+            return true;
+        }
+
+
+        /**
+         * The normalized form of 'directory', ending with a slash, or empty for the current directory.
+         */
+        std::string directoryPrefix(const std::filesystem::path &directory) {
+            std::string prefix = directory.lexically_normal().string();
+
+            if (prefix.empty() || prefix == "." || prefix == "./") {
+                return "";
+            }
+
+            if (prefix.back() != '/') {
+                prefix += '/';
+            }
+
+            return prefix;
+        }
+
+
+        /**
+         * Appends 'file' to the directory prefix 'directory', normalizing the result. Most files of a 
+         * component are plain relative paths, which need just a concatenation.
+         */
+        std::string joinPath(const std::string &directory, const std::string &file) {
+            if (file.empty()) {
+                return directory.empty() ? "." : directory;
+            }
+
+            if (isPlainRelativePath(file)) {
+                return directory + file;
+            }
+
+            return (std::filesystem::path(directory.empty() ? "." : directory) / file).lexically_normal().string();
+        }
+
+
+        void createParentDirectory(const std::string &file) {
+            const std::filesystem::path directory = std::filesystem::path(file).parent_path();
+
+            if (! directory.empty()) {
+                std::filesystem::create_directories(directory);
+            }
+        }
+
+
+        /**
+         * Like "ETA 1:05".
+         */
+        std::string formatTimeLeft(const double seconds) {
+            const auto total = static_cast<long>(seconds + 0.5);
+            const long minutes = total / 60;
+            const long rest = total % 60;
+
+            return "ETA " + std::to_string(minutes) + (rest < 10 ? ":0" : ":") + std::to_string(rest);
+        }
+    }
+
+
+    BuildSystem::BuildSystem(Package *package, BuildCache *buildCache, Listener *listener, JobScheduler *scheduler) {
         this->package = package;
         this->buildCache = buildCache;
         this->listener = listener;
+        this->scheduler = scheduler;
     }
 
 
+    /**
+     * Actions added to the graph for a single component.
+     */
+    struct BuildSystem::ComponentActions {
+        std::vector<std::string> objects;
+        std::vector<ActionId> compileActions;
+        std::optional<ActionId> linkAction;
+        std::vector<std::string> libraries;     // what its dependents link against
+        std::vector<std::string> interface;     // what its dependents link again when it changes
+        bool visited = false;
+    };
+
+
     void BuildSystem::build(const Compiler &compiler, const Linker linker) {
-        for (Component *component : package->getComponents()) {
-            this->build(compiler, linker, component);
+        BuildGraph graph;
+
+        buildCache->startBuild();
+
+        // normalized once, so the paths of the files within each component can be just concatenated
+        const std::string outputDirectory = configuration.resolveOutputDirectory(package->getPath());
+        directories.clear();
+
+        for (const Component *component : package->getComponents()) {
+            ComponentDirectories &componentDirectories = directories[component];
+            componentDirectories.source = directoryPrefix(std::filesystem::path(package->getPath()) / component->getPath());
+            componentDirectories.output = outputDirectory.empty() 
+                ? componentDirectories.source 
+                : directoryPrefix(std::filesystem::path(outputDirectory) / component->getPath());
         }
+
+        const std::size_t statCount = buildCache->getFileStates().getStatCount();
+        std::vector<ActionEstimate> estimates;
+
+        {
+            Trace::Scope scope {Trace::getDefault(), "BuildSystem::graph", "graph"};
+
+            std::map<const Component*, ComponentActions> components;
+
+            for (Component *component : package->getComponents()) {
+                this->addCompileActions(graph, compiler, component, components[component]);
+            }
+
+            for (Component *component : package->getComponents()) {
+                std::set<const Component*> visiting;
+                this->addLinkAction(graph, linker, component, components, visiting);
+            }
+
+            // the slowest actions (and the ones the slowest chains go through) start first
+            estimates = this->estimateActions(graph, compiler);
+            graph.computeCriticalPaths();
+
+            // what finding out what's out of date cost, which is all a no-op build does
+            const std::size_t checkStats = buildCache->getFileStates().getStatCount() - statCount;
+            Trace::getDefault().setMetric("check.fileStats", static_cast<double>(checkStats));
+
+            scope.setArg("actions", static_cast<std::int64_t>(graph.getActionCount()));
+            scope.setArg("fileStats", static_cast<std::int64_t>(checkStats));
+        }
+
+        this->execute(graph, estimates);
     }
 
 
-    void BuildSystem::build(const Compiler &compiler, const Linker linker, const Component *component) {
-        std::vector<std::string> objects;
+    void BuildSystem::addLinkAction(BuildGraph &graph, const Linker &linker, const Component *component, std::map<const Component*, ComponentActions> &components, std::set<const Component*> &visiting) {
+        ComponentActions &actions = components[component];
 
-        for (const std::string &source : component->getSources()) {
-            if (! compiler.isCompilable(source)) {
+        if (actions.visited) {
+            return;
+        }
+
+        if (! visiting.insert(component).second) {
+            throw std::runtime_error("The component '" + component->getName() + "' depends on itself");
+        }
+
+        // dependencies first, so it's known whether they'll be linked again
+        bool dependencyLinked = false;
+        std::vector<std::string> libraries;
+        std::vector<std::string> dependencyInputs;
+
+        for (const Component *dependency : component->getDependencies()) {
+            if (components.find(dependency) == components.end()) {
+                // from another package, assumed to be built already
                 continue;
             }
-            
-            const std::string sourceFile = component->getPackage()->getPath() + component->getPath() + source;
-            const CompileOutput output = compiler.compile(sourceFile);
 
-            if (buildCache->sourceNeedsRebuild(sourceFile)) {
-                if (listener) {
-                    listener->receiveOutput(output);
-                    buildCache->sourceBuilt(sourceFile);
+            this->addLinkAction(graph, linker, dependency, components, visiting);
+
+            const ComponentActions &dependencyActions = components[dependency];
+            dependencyLinked = dependencyLinked || dependencyActions.linkAction.has_value();
+            libraries.insert(libraries.end(), dependencyActions.libraries.begin(), dependencyActions.libraries.end());
+            dependencyInputs.insert(dependencyInputs.end(), dependencyActions.interface.begin(), dependencyActions.interface.end());
+        }
+
+        visiting.erase(component);
+        actions.visited = true;
+
+        // a library reached through several dependencies goes last, after everything that may need it
+        libraries = keepLastOccurrences(libraries);
+        dependencyInputs = keepLastOccurrences(dependencyInputs);
+
+        const Component::Type type = component->getType();
+
+        LinkerOutput output = type == Component::Type::StaticLibrary 
+            ? linker.archive(component->getName(), this->outputPath(component, "lib" + component->getName() + ".a"), actions.objects)
+            : type == Component::Type::SharedLibrary 
+                ? linker.linkSharedLibrary(component->getName(), this->outputPath(component, "lib" + component->getName() + ".so"), actions.objects, libraries)
+                : linker.link(component->getName(), this->outputPath(component, component->getName()), actions.objects, libraries);
+
+        switch (type) {
+        case Component::Type::StaticLibrary:
+            // a thin archive holds the paths of its objects, not their content. Its dependencies, which 
+            // it doesn't contain, are linked into whatever links against it
+            actions.libraries = {output.executable};
+            actions.libraries.insert(actions.libraries.end(), libraries.begin(), libraries.end());
+            actions.interface = {output.executable};
+            actions.interface.insert(actions.interface.end(), actions.objects.begin(), actions.objects.end());
+            actions.interface.insert(actions.interface.end(), dependencyInputs.begin(), dependencyInputs.end());
+            break;
+
+        case Component::Type::SharedLibrary:
+            // its dependents only care about what it exports
+            actions.libraries = {output.executable};
+            actions.interface = {output.interfaceFile};
+            break;
+
+        case Component::Type::Executable:
+            // nothing links against it, but its dependents are still linked after it
+            actions.interface = {output.executable};
+            break;
+        }
+
+        output.dependencies = std::move(dependencyInputs);
+
+        if (actions.compileActions.empty() && !dependencyLinked) {
+            // the output and its objects are all that's left to check
+            buildCache->prefetchFileStates({output.executable}, scheduler);
+        }
+
+        // when its inputs are still to be built, it's decided once they are (see runAction)
+        const bool upToDate = actions.compileActions.empty() 
+            && ! dependencyLinked 
+            && ! buildCache->linkNeedsRebuild(output.executable, output.command.toString(), output.getInputs())
+            && (output.interfaceFile.empty() || std::filesystem::exists(output.interfaceFile));
+
+        if (upToDate) {
+            Trace::getDefault().count("links.skipped");
+            return;
+        }
+
+        // the link waits for the compiles of its objects, and the links of its dependencies, on its own
+        createParentDirectory(output.executable);
+        actions.linkAction = graph.addLink(component, output);
+    }
+
+
+    void BuildSystem::addCompileActions(BuildGraph &graph, const Compiler &compiler, const Component *component, ComponentActions &actions) {
+        Trace &trace = Trace::getDefault();
+        Trace::Scope scope {trace, "check " + component->getName(), "stat"};
+
+        std::vector<std::string> &objects = actions.objects;
+        std::vector<ActionId> &compileActions = actions.compileActions;
+
+        const std::vector<std::string> sources = this->getSourceFiles(compiler, component);
+
+        CompileOptions options;
+        options.prefixHeader = this->preparePrefixHeader(component, sources);
+        // static libraries too, as they may end up in a shared one
+        options.positionIndependent = component->getType() != Component::Type::Executable;
+
+        std::string &prefixHeader = options.prefixHeader;
+        std::optional<ActionId> prefixHeaderAction;
+
+        if (const auto output = prefixHeader.empty() ? std::nullopt : compiler.precompileHeader(prefixHeader, options); !output) {
+            prefixHeader.clear();
+        } else if (buildCache->sourceNeedsRebuild(prefixHeader, output->command.toString())) {
+            // parsing the headers once is worth a couple of regular compiles
+            prefixHeaderAction = graph.addCompile(component, *output, 2.0);
+        }
+
+        const std::vector<std::string> translationUnits = this->getTranslationUnits(component, sources);
+
+        // every source and header of the component gets stated once, up front, instead of one at a time below
+        buildCache->prefetchFileStates(translationUnits, scheduler);
+
+        std::set<std::string> objectDirectories;
+
+        for (const std::string &sourceFile : translationUnits) {
+            const std::string objectFile = this->objectPath(component, sourceFile);
+            const CompileOutput output = compiler.compile(sourceFile, objectFile, options);
+
+            // a new precompiled header invalidates every object built with the previous one
+            if (prefixHeaderAction || buildCache->sourceNeedsRebuild(sourceFile, output.command.toString())) {
+                if (objectDirectories.insert(std::filesystem::path(objectFile).parent_path().string()).second) {
+                    createParentDirectory(objectFile);
+                }
+
+                const ActionId compileAction = graph.addCompile(component, output);
+
+                if (prefixHeaderAction) {
+                    graph.addEdge(*prefixHeaderAction, compileAction);
                 }
+
+                compileActions.push_back(compileAction);
+                trace.count("sources.outOfDate");
+            } else {
+                trace.count("sources.upToDate");
             }
 
             objects.push_back(output.objectFile);
         }
 
-        const LinkerOutput output = linker.link(component->getName(), component->getPackage()->getPath() + component->getPath() + component->getName(), objects);
+        scope.setArg("sources", static_cast<std::int64_t>(objects.size()));
+        scope.setArg("outOfDate", static_cast<std::int64_t>(compileActions.size()));
+    }
+
+
+    std::vector<std::string> BuildSystem::getSourceFiles(const Compiler &compiler, const Component *component) const {
+        std::vector<std::string> files;
+        std::vector<std::string> patterns;
+
+        for (const std::string &source : component->getSources()) {
+            if (isGlobPattern(source)) {
+                patterns.push_back(source);
+            } else {
+                files.push_back(source);
+            }
+        }
+
+        if (! patterns.empty()) {
+            const std::vector<std::string> matches = expandGlobs(this->componentPath(component, ""), patterns, directoryCache, scheduler);
+            files.insert(files.end(), matches.begin(), matches.end());
+        }
+
+        std::vector<std::string> sources;
+
+        for (const std::string &file : files) {
+            if (compiler.isCompilable(file)) {
+                sources.push_back(this->componentPath(component, file));
+            }
+        }
+
+        return sources;
+    }
+
+
+    std::vector<std::string> BuildSystem::getTranslationUnits(const Component *component, const std::vector<std::string> &sources) const {
+        if (! unityBuild || sources.size() < 2) {
+            return sources;
+        }
+
+        // the number of buckets is kept from one build to the next, so it only changes when it has to
+        const std::string bucketsFile = this->outputPath(component, component->getName() + ".unity-buckets");
+        std::size_t bucketCount = 0;
+
+        if (std::ifstream is {bucketsFile}; !(is >> bucketCount)) {
+            bucketCount = 0;
+        }
+
+        const std::size_t jobSlots = scheduler ? static_cast<std::size_t>(scheduler->getJobLimit()) : 1;
+        const std::vector<UnityBatch> batches = planUnityBatches(sources, unityBatchSize, jobSlots, bucketCount);
+
+        createParentDirectory(bucketsFile);
+        writeFileIfChanged(bucketsFile, std::to_string(bucketCount) + "\n");
+
+        std::vector<std::string> translationUnits;
+
+        for (const UnityBatch &batch : batches) {
+            if (batch.sources.size() == 1) {
+                translationUnits.push_back(batch.sources[0]);
+                continue;
+            }
+
+            // the batch's depfile lists its sources, so editing one of them rebuilds just this batch
+            const std::string unityFile = this->outputPath(component, component->getName() + ".unity-" + batch.name + ".cpp");
+            writeFileIfChanged(unityFile, makeUnitySource(unityFile, batch.sources));
+
+            translationUnits.push_back(unityFile);
+        }
+
+        return translationUnits;
+    }
+
+
+    std::string BuildSystem::preparePrefixHeader(const Component *component, const std::vector<std::string> &sources) const {
+        if (! component->getPrefixHeader().empty()) {
+            const std::string header = this->componentPath(component, component->getPrefixHeader());
+
+            if (configuration.getOutputDirectory().empty()) {
+                return header;
+            }
+
+            // gcc looks for the precompiled header next to it, so each configuration gets its own copy to precompile
+            const std::string prefixHeader = this->outputPath(component, component->getName() + ".prefix.hpp");
+            const std::string include = std::filesystem::path(header).lexically_relative(std::filesystem::path(prefixHeader).parent_path()).generic_string();
+
+            createParentDirectory(prefixHeader);
+            writeFileIfChanged(prefixHeader, "\n// generated by bok: the prefix header of the component\n\n#include \"" + include + "\"\n");
+
+            return prefixHeader;
+        }
+
+        if (! component->hasAutomaticPrefixHeader()) {
+            return "";
+        }
+
+        IncludeScanner localScanner;
+        const std::vector<std::string> headers = findCommonSystemHeaders(includeScanner ? *includeScanner : localScanner, sources);
+
+        if (headers.empty()) {
+            return "";
+        }
+
+        const std::string prefixHeader = this->outputPath(component, component->getName() + ".prefix.hpp");
+        createParentDirectory(prefixHeader);
+        writePrefixHeader(prefixHeader, headers);
+
+        return prefixHeader;
+    }
+
+
+    void BuildSystem::execute(BuildGraph &graph, const std::vector<ActionEstimate> &estimates) {
+        using ReadyAction = std::pair<double, ActionId>;
+
+        std::mutex mutex;
+        std::condition_variable actionFinished;
+        std::priority_queue<ReadyAction> readyCompiles;
+        std::priority_queue<ReadyAction> readyLinks;
+        std::vector<std::uint32_t> pending(graph.getActionCount());
+        std::size_t running = 0;
+        std::size_t finished = 0;
+        std::size_t failureCount = 0;
+        std::exception_ptr firstFailure;
+
+        const bool keepGoing = scheduler ? scheduler->isKeepGoing() : false;
+        const std::size_t jobLimit = scheduler ? static_cast<std::size_t>(scheduler->getJobLimit()) : 1;
+
+        Trace &trace = Trace::getDefault();
+        Trace::Scope scope {trace, "BuildSystem::execute", "build"};
+
+        // the progress is only shown on terminals, so there is nothing to format otherwise
+        Log &log = Log::getDefault();
+        const bool showProgress = log.hasStatusLine();
+
+        const auto startTime = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration busyTime {};
+
+        // what's needed for the estimated time left
+        std::vector<std::chrono::steady_clock::time_point> startTimes(showProgress ? graph.getActionCount() : 0);
+        std::vector<ActionId> runningActions;
+        double remainingWork = 0.0;
+
+        for (const ActionEstimate &estimate : estimates) {
+            remainingWork += estimate.duration;
+        }
+
+        // at least the longest chain still to go, and at most the work left spread over every job
+        auto estimateTimeLeft = [&] () {
+            const auto now = std::chrono::steady_clock::now();
+            double runningWork = 0.0;
+            double longestPath = 0.0;
+
+            for (const ActionId action : runningActions) {
+                const double elapsed = std::min(std::chrono::duration<double>(now - startTimes[action]).count(), estimates[action].duration);
+
+                runningWork += estimates[action].duration - elapsed;
+                longestPath = std::max(longestPath, graph.getCriticalPath(action) - elapsed);
+            }
+
+            for (const auto *ready : {&readyCompiles, &readyLinks}) {
+                if (! ready->empty()) {
+                    longestPath = std::max(longestPath, ready->top().first);
+                }
+            }
+
+            return std::max(longestPath, (remainingWork + runningWork) / static_cast<double>(jobLimit));
+        };
+
+        auto makeReady = [&] (const ActionId action) {
+            auto &ready = graph.getType(action) == BuildGraph::ActionType::Link ? readyLinks : readyCompiles;
+            ready.push({graph.getCriticalPath(action), action});
+        };
+
+        for (ActionId i = 0; i < graph.getActionCount(); i++) {
+            pending[i] = graph.getDependencyCount(i);
+
+            if (pending[i] == 0) {
+                makeReady(i);
+            }
+        }
+
+        // the ready action with the longest critical path that can start now, if any
+        auto admitNext = [&] () -> std::optional<ActionId> {
+            std::priority_queue<ReadyAction> *candidates[2] = {&readyCompiles, &readyLinks};
+
+            if (readyCompiles.empty() || (!readyLinks.empty() && readyLinks.top().first > readyCompiles.top().first)) {
+                std::swap(candidates[0], candidates[1]);
+            }
+
+            for (std::priority_queue<ReadyAction> *ready : candidates) {
+                if (ready->empty()) {
+                    continue;
+                }
+
+                const ActionId action = ready->top().second;
+                const bool admitted = resourceBudget
+                    ? resourceBudget->tryReserve(ready == &readyLinks, estimates[action].memory, running, jobLimit)
+                    : running < jobLimit;
+
+                if (admitted) {
+                    ready->pop();
+                    return action;
+                }
+            }
+
+            return {};
+        };
+
+        auto run = [&] (const ActionId index) {
+            const auto actionStart = std::chrono::steady_clock::now();
+            std::exception_ptr failure;
+
+            try {
+                this->runAction(graph, index);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+
+            trace.count(failure ? "actions.failed" : "actions.run");
+
+            std::lock_guard<std::mutex> lock{mutex};
+            running--;
+            finished++;
+            busyTime += std::chrono::steady_clock::now() - actionStart;
+
+            if (resourceBudget) {
+                resourceBudget->release(graph.getType(index) == BuildGraph::ActionType::Link, estimates[index].memory);
+            }
+
+            if (showProgress) {
+                runningActions.erase(std::find(runningActions.begin(), runningActions.end(), index));
+            }
+
+            if (failure) {
+                // whatever depends on it will never become ready
+                if (failureCount++ == 0) {
+                    firstFailure = failure;
+                }
+            } else {
+                for (const ActionId dependent : graph.getDependents(index)) {
+                    if (--pending[dependent] == 0) {
+                        makeReady(dependent);
+                    }
+                }
+            }
+
+            if (showProgress) {
+                const std::string &name = graph.getType(index) == BuildGraph::ActionType::Compile
+                    ? graph.getCompileOutput(index).sourceFile
+                    : graph.getLinkerOutput(index).executable;
+
+                log.setStatus("[" + std::to_string(finished) + "/" + std::to_string(graph.getActionCount()) + ", " + formatTimeLeft(estimateTimeLeft()) + "] " + name);
+            }
+
+            actionFinished.notify_one();
+        };
+
+        std::unique_lock<std::mutex> lock{mutex};
+
+        while (true) {
+            const bool stopped = failureCount > 0 && !keepGoing;
+
+            if (stopped || (readyCompiles.empty() && readyLinks.empty())) {
+                if (running == 0) {
+                    break;
+                }
+
+                actionFinished.wait(lock);
+                continue;
+            }
+
+            // only hand out as many actions as there is room for, so the priorities keep being honored
+            const std::optional<ActionId> index = admitNext();
+
+            if (! index) {
+                if (running >= jobLimit) {
+                    actionFinished.wait(lock);
+                } else {
+                    // held back by the resource budget, until something finishes
+                    trace.count("resources.deferred");
+                    actionFinished.wait_for(lock, std::chrono::milliseconds(250));
+                }
 
-        if (listener) {
-            listener->receiveOutput(output);
+                continue;
+            }
+
+            running++;
+            remainingWork -= estimates[*index].duration;
+
+            if (showProgress) {
+                startTimes[*index] = std::chrono::steady_clock::now();
+                runningActions.push_back(*index);
+            }
+
+            if (scheduler) {
+                scheduler->submit([&run, action = *index] () {
+                    run(action);
+                });
+            } else {
+                lock.unlock();
+                run(*index);
+                lock.lock();
+            }
+        }
+
+        lock.unlock();
+
+        if (showProgress) {
+            log.setStatus("");
+        }
+
+        // time the workers could have spent running actions, but didn't
+        const auto wallTime = std::chrono::steady_clock::now() - startTime;
+        const auto idleTime = wallTime * static_cast<long>(jobLimit) - busyTime;
+
+        trace.setMetric("build.wallSeconds", std::chrono::duration<double>(wallTime).count());
+        trace.setMetric("scheduler.busySeconds", std::chrono::duration<double>(busyTime).count());
+        trace.setMetric("scheduler.idleSeconds", std::chrono::duration<double>(idleTime).count());
+        trace.setMetric("scheduler.jobLimit", static_cast<double>(jobLimit));
+
+        if (resourceBudget) {
+            trace.setMetric("resources.memoryLimit", static_cast<double>(resourceBudget->getMemoryLimit()));
+            trace.setMetric("resources.peakReservedMemory", static_cast<double>(resourceBudget->getPeakReservedMemory()));
+        }
+
+        if (failureCount > 1) {
+            throw std::runtime_error(std::to_string(failureCount) + " build actions failed");
+        }
+
+        if (firstFailure) {
+            std::rethrow_exception(firstFailure);
         }
     }
 
-}
\ No newline at end of file
+
+    std::vector<BuildSystem::ActionEstimate> BuildSystem::estimateActions(BuildGraph &graph, const Compiler &compiler) const {
+        std::vector<ActionEstimate> estimates(graph.getActionCount());
+
+        // actions without a history are assumed to take as much as the others of their kind, on average
+        double totalDurations[2] = {0.0, 0.0};
+        std::size_t durationCounts[2] = {0, 0};
+        std::uint64_t totalMemory[2] = {0, 0};
+        std::size_t memoryCounts[2] = {0, 0};
+
+        for (ActionId i = 0; i < graph.getActionCount(); i++) {
+            const bool link = graph.getType(i) == BuildGraph::ActionType::Link;
+            const std::string &file = link ? graph.getLinkerOutput(i).executable : graph.getCompileOutput(i).sourceFile;
+            const std::optional<BuildCache::ActionHistory> history = buildCache->getHistory(file);
+
+            if (! history) {
+                continue;
+            }
+
+            if (! history->durations.empty()) {
+                // the median shrugs off the odd build slowed down by something else
+                std::vector<std::chrono::microseconds> durations = history->durations;
+                std::nth_element(durations.begin(), durations.begin() + durations.size() / 2, durations.end());
+
+                estimates[i].duration = std::chrono::duration<double>(durations[durations.size() / 2]).count();
+                totalDurations[link] += estimates[i].duration;
+                durationCounts[link]++;
+            }
+
+            if (history->usage.isKnown()) {
+                estimates[i].memory = history->usage.peakMemory;
+                totalMemory[link] += history->usage.peakMemory;
+                memoryCounts[link]++;
+            }
+        }
+
+        this->weighUnknownCompiles(graph, compiler, estimates);
+
+        const double defaultDurations[2] = {
+            durationCounts[0] > 0 ? totalDurations[0] / static_cast<double>(durationCounts[0]) : 1.0, 
+            durationCounts[1] > 0 ? totalDurations[1] / static_cast<double>(durationCounts[1]) : 1.0
+        };
+
+        const std::uint64_t defaultMemory[2] = {
+            memoryCounts[0] > 0 ? totalMemory[0] / memoryCounts[0] : ResourceBudget::DEFAULT_COMPILE_MEMORY, 
+            memoryCounts[1] > 0 ? totalMemory[1] / memoryCounts[1] : ResourceBudget::DEFAULT_LINK_MEMORY
+        };
+
+        for (ActionId i = 0; i < graph.getActionCount(); i++) {
+            const bool link = graph.getType(i) == BuildGraph::ActionType::Link;
+
+            if (estimates[i].duration == 0.0) {
+                // the cost given to the graph is relative to a regular action
+                estimates[i].duration = graph.getCost(i) * defaultDurations[link];
+            }
+
+            if (estimates[i].memory == 0) {
+                estimates[i].memory = defaultMemory[link];
+            }
+
+            graph.setCost(i, estimates[i].duration);
+        }
+
+        return estimates;
+    }
+
+
+    void BuildSystem::weighUnknownCompiles(BuildGraph &graph, const Compiler &compiler, const std::vector<ActionEstimate> &estimates) const {
+        if (! includeScanner) {
+            return;
+        }
+
+        std::vector<ActionId> actions;
+        std::vector<std::string> sources;
+
+        for (ActionId i = 0; i < graph.getActionCount(); i++) {
+            if (graph.getType(i) == BuildGraph::ActionType::Compile && estimates[i].duration == 0.0) {
+                actions.push_back(i);
+                sources.push_back(graph.getCompileOutput(i).sourceFile);
+            }
+        }
+
+        if (sources.empty()) {
+            return;
+        }
+
+        Trace &trace = Trace::getDefault();
+        Trace::Scope scope {trace, "scan includes", "stat"};
+        const std::size_t scanCount = includeScanner->getScanCount();
+
+        const std::vector<IncludeScanner::Closure> closures = includeScanner->findClosures(sources, compiler.getIncludeDirectories());
+        double totalSize = 0.0;
+
+        for (const IncludeScanner::Closure &closure : closures) {
+            totalSize += static_cast<double>(closure.size);
+        }
+
+        if (totalSize == 0.0) {
+            return;
+        }
+
+        // relative to the average, as the costs are relative to a regular action
+        const double averageSize = totalSize / static_cast<double>(closures.size());
+
+        for (std::size_t i = 0; i < actions.size(); i++) {
+            graph.setCost(actions[i], graph.getCost(actions[i]) * static_cast<double>(closures[i].size) / averageSize);
+        }
+
+        // the files read for the first time, or since they changed
+        trace.setMetric("includes.scannedFiles", static_cast<double>(includeScanner->getScanCount() - scanCount));
+        scope.setArg("sources", static_cast<std::int64_t>(sources.size()));
+    }
+
+
+    void BuildSystem::runAction(const BuildGraph &graph, const ActionId action) {
+        if (! listener) {
+            return;
+        }
+
+        Trace &trace = Trace::getDefault();
+
+        if (graph.getType(action) == BuildGraph::ActionType::Link) {
+            const LinkerOutput &output = graph.getLinkerOutput(action);
+            const std::vector<std::string> inputs = output.getInputs();
+            Trace::Scope scope {trace, output.executable, "link"};
+
+            // early cutoff: rebuilt inputs often come out byte for byte the same (like after editing a comment)
+            if (! buildCache->linkNeedsRebuild(output.executable, output.command.toString(), inputs)) {
+                listener->receiveUnchangedOutput(output);
+                trace.count("links.cutoff");
+                scope.setArg("cutoff", 1);
+
+                return;
+            }
+
+            // an archive would keep the members it no longer has, and a library may be mapped by running programs
+            std::remove(output.executable.c_str());
+
+            const ProcessResult result = listener->receiveOutput(output);
+            scope.setArg("peakMemory", static_cast<std::int64_t>(result.getResourceUsage().peakMemory));
+
+            buildCache->linkBuilt(output.executable, output.command.toString(), inputs, result.getResourceUsage());
+
+            // its dependents are linked again only when the exported symbols change
+            if (! output.interfaceFile.empty()) {
+                if (Linker::writeInterface(output.executable, output.interfaceFile)) {
+                    buildCache->fileWritten(output.interfaceFile);
+                } else {
+                    trace.count("links.interfaceUnchanged");
+                }
+            }
+
+            return;
+        }
+
+        const CompileOutput &output = graph.getCompileOutput(action);
+        Trace::Scope scope {trace, output.sourceFile, "compile"};
+
+        // unknown for cached and remote compiles, which keep the usage of their last local compile
+        ResourceUsage usage;
+
+        if (objectCache && objectCache->restore(output)) {
+            listener->receiveCachedOutput(output);
+            trace.count("objectCache.hits");
+            scope.setArg("cached", 1);
+        } else {
+            if (objectCache) {
+                trace.count("objectCache.misses");
+
+                // the previous object may be a hardlink into the object cache
+                std::remove(output.objectFile.c_str());
+            }
+
+            if (! this->compileRemotely(output)) {
+                usage = listener->receiveOutput(output).getResourceUsage();
+                scope.setArg("peakMemory", static_cast<std::int64_t>(usage.peakMemory));
+            }
+
+            if (objectCache) {
+                objectCache->store(output);
+            }
+        }
+
+        buildCache->fileWritten(output.objectFile);
+
+        std::vector<std::string> dependencies = loadDepFile(output.dependencyFile);
+        dependencies.insert(dependencies.end(), output.implicitDependencies.begin(), output.implicitDependencies.end());
+
+        buildCache->sourceBuilt(output.sourceFile, output.command.toString(), dependencies, usage);
+    }
+
+
+    bool BuildSystem::compileRemotely(const CompileOutput &output) {
+        if (! workerPool) {
+            return false;
+        }
+
+        const std::optional<ProcessResult> result = workerPool->compile(output);
+
+        if (! result) {
+            return false;
+        }
+
+        listener->receiveRemoteOutput(output, *result);
+
+        if (! result->succeeded()) {
+            throw CommandError("The following command failed: " + output.command.toString(), *result);
+        }
+
+        Trace::getDefault().count("workers.compiles");
+
+        return true;
+    }
+
+
+    std::string BuildSystem::componentPath(const Component *component, const std::string &file) const {
+        return joinPath(directories.at(component).source, file);
+    }
+
+
+    std::string BuildSystem::outputPath(const Component *component, const std::string &file) const {
+        return joinPath(directories.at(component).output, file);
+    }
+
+
+    std::string BuildSystem::objectPath(const Component *component, const std::string &sourceFile) const {
+        if (configuration.getOutputDirectory().empty()) {
+            return sourceFile + ".obj";
+        }
+
+        const ComponentDirectories &componentDirectories = directories.at(component);
+        const std::string_view sourceView {sourceFile};
+
+        // generated sources (like unity batches) already live in the output directory
+        if (sourceView.compare(0, componentDirectories.output.size(), componentDirectories.output) == 0 && isPlainRelativePath(sourceView.substr(componentDirectories.output.size()))) {
+            return sourceFile + ".obj";
+        }
+
+        if (sourceView.compare(0, componentDirectories.source.size(), componentDirectories.source) == 0 && isPlainRelativePath(sourceView.substr(componentDirectories.source.size()))) {
+            return componentDirectories.output + sourceFile.substr(componentDirectories.source.size()) + ".obj";
+        }
+
+        const std::filesystem::path source {sourceFile};
+        const std::filesystem::path outputDirectory = this->outputPath(component, "");
+        const std::filesystem::path relative = source.lexically_relative(this->componentPath(component, ""));
+
+        if (relative.empty()) {
+            return (outputDirectory / source.filename()).string() + ".obj";
+        }
+
+        // sources from outside of the component still get a place of their own within its output directory
+        std::filesystem::path object = outputDirectory;
+
+        for (const std::filesystem::path &part : relative) {
+            object /= (part == ".." ? std::filesystem::path("__") : part);
+        }
+
+        return object.string() + ".obj";
+    }
+}
@@ -1,8 +1,8 @@
 
 #include <bok/core/Command.hpp>
 
-#include <cstdlib>
-#include <stdexcept>
+#include <bok/core/ProcessManager.hpp>
+#include <bok/core/Trace.hpp>
 
 
 namespace bok {
@@ -21,15 +21,44 @@ namespace bok {
     }
 
 
-    void Command::execute() const {
-        std::string cmdline = path + name;
+    std::string Command::toString() const {
+        auto quote = [] (const std::string &value) {
+            if (value.find_first_of(" \t\"'\\$") == std::string::npos) {
+                return value;
+            }
+
+            std::string quoted = "'";
+
+            for (const char ch : value) {
+                quoted += (ch == '\'') ? std::string{"'\\''"} : std::string{ch};
+            }
+
+            return quoted + "'";
+        };
+
+        std::string cmdline = quote(path + name);
 
         for (const std::string &arg : args) {
-            cmdline += " " + arg;
+            cmdline += " " + quote(arg);
         }
 
-        if (int exitCode = std::system(cmdline.c_str()); exitCode != 0) {
-            throw std::runtime_error("The following command failed: " + cmdline);
+        return cmdline;
+    }
+
+
+    ProcessResult Command::execute() const {
+        const ProcessResult result = ProcessManager::getDefault().run(*this);
+
+        // attached to the trace event of the action running this command
+        Trace::annotate("exitCode", result.exitCode);
+        Trace::annotate("maxRssKb", result.usage.ru_maxrss);
+        Trace::annotate("userMs", result.usage.ru_utime.tv_sec * 1000 + result.usage.ru_utime.tv_usec / 1000);
+        Trace::annotate("systemMs", result.usage.ru_stime.tv_sec * 1000 + result.usage.ru_stime.tv_usec / 1000);
+
+        if (! result.succeeded()) {
+            throw CommandError("The following command failed: " + this->toString(), result);
         }
+
+        return result;
     }
 }
@@ -0,0 +1,303 @@
+
+#include <bok/core/CompileWorker.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <bok/core/Command.hpp>
+#include <bok/core/Log.hpp>
+
+
+namespace bok {
+    namespace {
+        // written to by the signal handler, to wake the worker up
+        int signalPipe[2] = {-1, -1};
+
+        void handleSignal(int) {
+            const char byte = 0;
+            [[maybe_unused]] const ssize_t written = ::write(signalPipe[1], &byte, 1);
+        }
+
+
+        // threads reading the requests, which only wait on slow clients
+        constexpr int CONNECTION_THREADS = 8;
+
+
+        const std::vector<std::string> ALLOWED_COMPILERS = {"gcc", "g++", "cc", "c++", "clang", "clang++"};
+
+        // anything else is refused: flags that load code, run other programs or write files are too many to list
+        const std::vector<std::string> ALLOWED_FLAGS = {"-c", "-w", "-ansi", "-pedantic", "-pedantic-errors", "-pthread"};
+
+        // joined to their value, if any. Those of the optimizer, the debug information and the code generator 
+        // write nothing outside the scratch directory the object goes to
+        const std::vector<std::string> ALLOWED_FLAG_PREFIXES = {"-O", "-g", "-f", "-m", "-W", "-D", "-U", "-I"};
+
+        // the only ones taking a value after '=' (like '-fopt-info=<file>' does, a file name)
+        const std::vector<std::string> ALLOWED_VALUE_FLAG_PREFIXES = {
+            "-std=", "-march=", "-mtune=", "-mcpu=", 
+            "-fvisibility=", "-fsanitize=", "-fno-sanitize=", "-ftemplate-depth=", "-fconstexpr-depth=", "-fconstexpr-steps=", 
+            "-fmax-errors=", "-fdiagnostics-color=", "-fabi-version=", "-fdebug-prefix-map=", "-fmacro-prefix-map=", "-ffile-prefix-map="
+        };
+
+        // the languages of preprocessed sources, for '-x'
+        const std::vector<std::string> ALLOWED_LANGUAGES = {"c++-cpp-output", "cpp-output"};
+
+
+        bool hasPrefix(const std::string &value, const std::vector<std::string> &prefixes) {
+            return std::any_of(prefixes.begin(), prefixes.end(), [&value] (const std::string &prefix) {
+                return value.rfind(prefix, 0) == 0;
+            });
+        }
+
+
+        bool isAllowedFlag(const std::string &flag) {
+            if (std::find(ALLOWED_FLAGS.begin(), ALLOWED_FLAGS.end(), flag) != ALLOWED_FLAGS.end() || hasPrefix(flag, ALLOWED_VALUE_FLAG_PREFIXES)) {
+                return true;
+            }
+
+            if (! hasPrefix(flag, ALLOWED_FLAG_PREFIXES)) {
+                return false;
+            }
+
+            if (flag[1] == 'D' || flag[1] == 'U' || flag[1] == 'I') {
+                // not on their own, as the value would be the next argument
+                return flag.size() > 2;
+            }
+
+            if (flag[1] == 'W') {
+                // '-Wa,', '-Wl,' and '-Wp,' pass options on to other programs
+                return flag.find(',') == std::string::npos;
+            }
+
+            return flag.find('=') == std::string::npos;
+        }
+
+
+        std::string readFile(const std::string &path) {
+            std::ifstream is {path, std::ios::binary};
+            std::stringstream content;
+            content << is.rdbuf();
+
+            return content.str();
+        }
+    }
+
+
+    CompileWorker::CompileWorker(const WorkerEndpoint &endpoint, const int jobLimit) 
+        : scheduler(jobLimit, true), connections(CONNECTION_THREADS, true) {
+        this->endpoint = endpoint;
+        this->listenFd = listenOn(endpoint);
+    }
+
+
+    CompileWorker::~CompileWorker() {
+        // the requests being read may still queue compiles, and those running get to send their objects
+        connections.wait();
+        scheduler.wait();
+
+        ::close(listenFd);
+
+        if (endpoint.kind == WorkerEndpoint::Kind::Unix) {
+            ::unlink(endpoint.path.c_str());
+        }
+    }
+
+
+    void CompileWorker::run() {
+        if (::pipe2(signalPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+            throw std::runtime_error("Couldn't create a pipe: " + std::string{std::strerror(errno)});
+        }
+
+        struct sigaction action {};
+        struct sigaction previousInterrupt {};
+        struct sigaction previousTerminate {};
+        action.sa_handler = handleSignal;
+
+        ::sigaction(SIGINT, &action, &previousInterrupt);
+        ::sigaction(SIGTERM, &action, &previousTerminate);
+
+        Log::getDefault().print(LogLevel::Info, "Compiling on ", endpoint.toString(), ", up to ", scheduler.getJobLimit(), " at a time");
+
+        while (true) {
+            pollfd fds[2] = {
+                {listenFd, POLLIN, 0}, 
+                {signalPipe[0], POLLIN, 0}
+            };
+
+            if (::poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                break;
+            }
+
+            if (fds[1].revents) {
+                break;
+            }
+
+            const int clientFd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+
+            if (clientFd < 0) {
+                continue;
+            }
+
+            // read elsewhere, so a client that connects and goes silent doesn't hold up the others
+            connections.submit([this, clientFd] () {
+                this->serveConnection(clientFd);
+            });
+        }
+
+        ::sigaction(SIGINT, &previousInterrupt, nullptr);
+        ::sigaction(SIGTERM, &previousTerminate, nullptr);
+        ::close(signalPipe[0]);
+        ::close(signalPipe[1]);
+    }
+
+
+    bool CompileWorker::isAllowedCommand(const std::vector<std::string> &command) {
+        if (command.empty() || std::find(ALLOWED_COMPILERS.begin(), ALLOWED_COMPILERS.end(), command[0]) == ALLOWED_COMPILERS.end()) {
+            return false;
+        }
+
+        for (std::size_t i = 1; i < command.size(); i++) {
+            const std::string &arg = command[i];
+
+            if (arg == "{input}" || isAllowedFlag(arg)) {
+                continue;
+            }
+
+            // the object goes where the worker says, and nowhere else
+            if (arg == "-o" && i + 1 < command.size() && command[i + 1] == "{output}") {
+                i++;
+                continue;
+            }
+
+            if (arg == "-x" && i + 1 < command.size() && std::find(ALLOWED_LANGUAGES.begin(), ALLOWED_LANGUAGES.end(), command[i + 1]) != ALLOWED_LANGUAGES.end()) {
+                i++;
+                continue;
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+
+    void CompileWorker::serveConnection(const int clientFd) {
+        // a client that goes silent is dropped after a while
+        setSocketTimeout(clientFd, std::chrono::seconds{10});
+
+        const auto request = receiveMessage(clientFd);
+        std::uint8_t type = 0;
+
+        if (! request || ! WireReader{*request}.get(type)) {
+            ::close(clientFd);
+        } else if (type == static_cast<std::uint8_t>(WorkerRequest::Status)) {
+            sendMessage(clientFd, this->encodeLoad());
+            ::close(clientFd);
+        } else if (type == static_cast<std::uint8_t>(WorkerRequest::Compile)) {
+            activeJobs++;
+
+            scheduler.submit([this, clientFd] () {
+                this->serveCompile(clientFd);
+            });
+        } else {
+            ::close(clientFd);
+        }
+    }
+
+
+    void CompileWorker::serveCompile(const int clientFd) {
+        const auto request = receiveMessage(clientFd);
+
+        std::vector<std::string> command;
+        std::string input;
+
+        if (request) {
+            WireReader reader {*request};
+
+            if (reader.get(command) && reader.get(input)) {
+                sendMessage(clientFd, this->compile(command, input));
+            }
+        }
+
+        ::close(clientFd);
+        activeJobs--;
+    }
+
+
+    std::string CompileWorker::compile(const std::vector<std::string> &command, const std::string &input) {
+        ProcessResult result;
+        std::string object;
+
+        char directoryTemplate[] = "/tmp/bok-worker-XXXXXX";
+
+        if (! isAllowedCommand(command)) {
+            result.exitCode = 1;
+            result.standardError = "The worker refused to run the command\n";
+        } else if (const char *directory = ::mkdtemp(directoryTemplate); !directory) {
+            result.exitCode = 1;
+            result.standardError = "The worker couldn't create a scratch directory\n";
+        } else {
+            const std::string inputFile = std::string{directory} + "/input.ii";
+            const std::string outputFile = std::string{directory} + "/output.o";
+
+            {
+                std::ofstream os {inputFile, std::ios::binary};
+                os << input;
+            }
+
+            Command compiler {command[0]};
+
+            for (std::size_t i = 1; i < command.size(); i++) {
+                compiler.addArg(command[i] == "{input}" ? inputFile : command[i] == "{output}" ? outputFile : command[i]);
+            }
+
+            try {
+                result = compiler.execute();
+                object = readFile(outputFile);
+            } catch (const CommandError &error) {
+                result = error.getResult();
+            }
+
+            std::error_code errorCode;
+            std::filesystem::remove_all(directory, errorCode);
+        }
+
+        WireWriter response;
+        response
+            .put(static_cast<std::int32_t>(result.exitCode))
+            .put(result.standardOutput)
+            .put(result.standardError)
+            .put(object);
+
+        // the load as it will be once this compile is done
+        response
+            .put(static_cast<std::uint32_t>(activeJobs > 0 ? activeJobs - 1 : 0))
+            .put(static_cast<std::uint32_t>(scheduler.getJobLimit()));
+
+        return response.getData();
+    }
+
+
+    std::string CompileWorker::encodeLoad() const {
+        WireWriter response;
+        response
+            .put(static_cast<std::uint32_t>(activeJobs))
+            .put(static_cast<std::uint32_t>(scheduler.getJobLimit()));
+
+        return response.getData();
+    }
+}
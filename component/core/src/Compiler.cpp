@@ -3,4 +3,24 @@
 
 namespace bok {
     Compiler::~Compiler() {}
+
+
+    CompileOutput Compiler::compile(const std::string &source, const std::string &object, const CompileOptions &) const {
+        return this->compile(source, object);
+    }
+
+
+    std::optional<CompileOutput> Compiler::precompileHeader(const std::string &, const CompileOptions &) const {
+        return {};
+    }
+
+
+    std::optional<RemoteCompile> Compiler::prepareRemoteCompile(const CompileOutput &) const {
+        return {};
+    }
+
+
+    std::vector<std::string> Compiler::getIncludeDirectories() const {
+        return {};
+    }
 }
@@ -1,23 +1,164 @@
 
 #include <bok/core/CompilerGCC.hpp>
 
+#include <sstream>
+
 
 namespace bok {
-    CompileOutput CompilerGCC::compile(const std::string &source) const {
-        // std::cout << "clang -c " << source << " " << "-O0" << " " << "-g" << " " << "-o" << objectName(source) << std::endl;
-        const std::string object = objectName(source);
+    CompileOutput CompilerGCC::compile(const std::string &source, const std::string &object) const {
+        return this->compile(source, object, CompileOptions{});
+    }
 
-        return CompileOutput {
+
+    CompileOutput CompilerGCC::compile(const std::string &source, const std::string &object, const CompileOptions &options) const {
+        // std::cout << "clang -c " << source << " " << "-O0" << " " << "-g" << " " << "-o" << object << std::endl;
+        const std::string dependencies = dependencyName(object);
+
+        Command command = createCompilerCommand();
+        addCommonFlags(command.allowResponseFile(), options);
+
+        if (! options.prefixHeader.empty()) {
+            // gcc picks '<prefixHeader>.gch' up on its own
+            command
+                .addArg("-include")
+                .addArg(options.prefixHeader)
+                .addArg("-Winvalid-pch");
+        }
+
+        CompileOutput output {
             source, 
             object, 
-            createCompilerCommand()
-                .addArg("-std=c++17")
+            dependencies, 
+            command
                 .addArg("-c")
                 .addArg(source)
-                .addArg("-O0")
-                .addArg("-g")
+                .addArg("-MMD")
+                .addArg("-MF" + dependencies)
                 .addArg("-o" + object)
         };
+
+        if (! options.prefixHeader.empty()) {
+            output.implicitDependencies.push_back(options.prefixHeader);
+        }
+
+        output.options = options;
+
+        return output;
+    }
+
+
+    std::optional<CompileOutput> CompilerGCC::precompileHeader(const std::string &header, const CompileOptions &options) const {
+        const std::string object = header + ".gch";
+        const std::string dependencies = dependencyName(object);
+
+        Command command = createCompilerCommand();
+        addCommonFlags(command.allowResponseFile(), options);
+
+        return CompileOutput {
+            header, 
+            object, 
+            dependencies, 
+            command
+                .addArg("-x")
+                .addArg("c++-header")
+                .addArg(header)
+                .addArg("-MMD")
+                .addArg("-MF" + dependencies)
+                .addArg("-o" + object),
+            {},
+            options
+        };
+    }
+
+
+    std::optional<RemoteCompile> CompilerGCC::prepareRemoteCompile(const CompileOutput &output) const {
+        if (splitDwarf) {
+            // the '.dwo' files would stay on the worker
+            return {};
+        }
+
+        if (output.objectFile == output.sourceFile + ".gch") {
+            // a precompiled header is only of use to the compiler that wrote it, and from the 
+            // preprocessed text the worker would compile an object instead
+            return {};
+        }
+
+        const std::string preprocessedFile = output.objectFile + ".ii";
+
+        Command preprocess = createCompilerCommand();
+        addCommonFlags(preprocess.allowResponseFile(), output.options);
+
+        // the prefix header goes in as text, its precompiled form is of no use to the worker
+        for (const std::string &header : output.implicitDependencies) {
+            preprocess
+                .addArg("-include")
+                .addArg(header);
+        }
+
+        preprocess
+            .addArg("-E")
+            .addArg(output.sourceFile)
+            .addArg("-MMD")
+            .addArg("-MF" + output.dependencyFile)
+            .addArg("-MT")
+            .addArg(output.objectFile)
+            .addArg("-o" + preprocessedFile);
+
+        Command remote = createCompilerCommand();
+        addCommonFlags(remote, output.options);
+
+        remote
+            .addArg("-x")
+            .addArg("c++-cpp-output")
+            .addArg("-c")
+            .addArg("{input}")
+            .addArg("-o")
+            .addArg("{output}");
+
+        return RemoteCompile {preprocess, preprocessedFile, remote};
+    }
+
+
+    std::vector<std::string> CompilerGCC::getIncludeDirectories() const {
+        std::vector<std::string> directories;
+
+        // with the flags, so those given with '-I' come first
+        Command command = createCompilerCommand();
+        addCommonFlags(command, {});
+
+        command
+            .addArg("-x")
+            .addArg("c++")
+            .addArg("-E")
+            .addArg("-v")
+            .addArg("/dev/null")
+            .addArg("-o")
+            .addArg("/dev/null");
+
+        ProcessResult result;
+
+        try {
+            result = command.execute();
+        } catch (const std::exception &) {
+            return directories;
+        }
+
+        // listed one per line, indented, between these two
+        std::stringstream ss {result.standardError};
+        std::string line;
+        bool listing = false;
+
+        while (std::getline(ss, line)) {
+            if (line.rfind("#include <...> search starts here:", 0) == 0) {
+                listing = true;
+            } else if (line.rfind("End of search list.", 0) == 0) {
+                break;
+            } else if (listing && !line.empty() && line[0] == ' ') {
+                directories.push_back(line.substr(1));
+            }
+        }
+
+        return directories;
     }
 
 
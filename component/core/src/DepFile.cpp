@@ -0,0 +1,109 @@
+
+#include <bok/core/DepFile.hpp>
+
+#include <cstdio>
+#include <unordered_set>
+
+
+namespace bok {
+    std::vector<std::string> parseDepFile(const std::string &content) {
+        std::vector<std::string> prerequisites;
+        std::unordered_set<std::string> seen;
+
+        std::string token;
+        bool inTargets = true;
+
+        auto flushToken = [&] () {
+            if (token.empty()) {
+                return;
+            }
+
+            if (! inTargets && seen.insert(token).second) {
+                prerequisites.push_back(token);
+            }
+
+            token.clear();
+        };
+
+        const char *it = content.data();
+        const char *end = it + content.size();
+
+        while (it != end) {
+            const char ch = *it++;
+
+            switch (ch) {
+                case '\\':
+                    if (it != end && (*it == '\n' || *it == '\r')) {
+                        // line continuation
+                        flushToken();
+
+                        if (*it == '\r' && it + 1 != end && it[1] == '\n') {
+                            it++;
+                        }
+
+                        it++;
+                    } else if (it != end && (*it == ' ' || *it == '#' || *it == '\\')) {
+                        token += *it++;
+                    } else {
+                        token += ch;
+                    }
+                    break;
+
+                case '$':
+                    if (it != end && *it == '$') {
+                        it++;
+                    }
+
+                    token += '$';
+                    break;
+
+                case ':':
+                    if (inTargets && (it == end || *it == ' ' || *it == '\t' || *it == '\n' || *it == '\r')) {
+                        token.clear();
+                        inTargets = false;
+                    } else {
+                        token += ch;
+                    }
+                    break;
+
+                case ' ':
+                case '\t':
+                    flushToken();
+                    break;
+
+                case '\r':
+                case '\n':
+                    flushToken();
+                    inTargets = true;
+                    break;
+
+                default:
+                    token += ch;
+            }
+        }
+
+        flushToken();
+
+        return prerequisites;
+    }
+
+
+    std::vector<std::string> loadDepFile(const std::string &path) {
+        FILE *file = std::fopen(path.c_str(), "rb");
+
+        if (! file) {
+            return {};
+        }
+
+        std::string content;
+        char buffer[16384];
+
+        while (const size_t count = std::fread(buffer, 1, sizeof(buffer), file)) {
+            content.append(buffer, count);
+        }
+
+        std::fclose(file);
+
+        return parseDepFile(content);
+    }
+}
@@ -0,0 +1,179 @@
+
+#include <bok/core/DirectoryCache.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+
+namespace bok {
+    namespace {
+        constexpr char CACHE_MAGIC[8] = {'B', 'O', 'K', 'D', 'I', 'R', 'S', '1'};
+
+        // a directory modified this recently could still change within the same timestamp, after it was read
+        constexpr std::int64_t RACY_INTERVAL_NS = 2'000'000'000;
+
+        template<typename Value>
+        void writeValue(std::ostream &os, const Value value) {
+            os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+
+        template<typename Value>
+        bool readValue(std::istream &is, Value &value) {
+            return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(value)));
+        }
+
+
+        void writeString(std::ostream &os, const std::string &value) {
+            writeValue(os, static_cast<std::uint32_t>(value.size()));
+            os.write(value.data(), value.size());
+        }
+
+
+        bool readString(std::istream &is, std::string &value) {
+            std::uint32_t size = 0;
+
+            if (! readValue(is, size) || size > 64 * 1024) {
+                return false;
+            }
+
+            value.resize(size);
+
+            return static_cast<bool>(is.read(value.data(), size));
+        }
+    }
+
+
+    DirectoryCache::DirectoryCache(const std::string &cacheFile) {
+        this->cacheFile = cacheFile;
+        this->load();
+    }
+
+
+    DirectoryCache::~DirectoryCache() {
+        this->save();
+    }
+
+
+    std::optional<std::vector<DirectoryEntry>> DirectoryCache::find(const std::string &path, const std::int64_t modifiedTime, const std::uint64_t inode) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        auto it = listings.find(path);
+
+        if (it == listings.end() || it->second.modifiedTime != modifiedTime || it->second.inode != inode) {
+            return {};
+        }
+
+        it->second.used = true;
+
+        return it->second.entries;
+    }
+
+
+    void DirectoryCache::store(const std::string &path, const std::int64_t modifiedTime, const std::uint64_t inode, const std::vector<DirectoryEntry> &entries) {
+        const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        if (now - modifiedTime < RACY_INTERVAL_NS) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        listings[path] = Listing{modifiedTime, inode, entries, true};
+        changed = true;
+    }
+
+
+    void DirectoryCache::save() {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        bool dropped = false;
+
+        for (const auto &listing : listings) {
+            dropped = dropped || !listing.second.used;
+        }
+
+        if (cacheFile.empty() || !(changed || dropped)) {
+            return;
+        }
+
+        const std::string temporaryFile = cacheFile + ".tmp";
+
+        {
+            std::ofstream os {temporaryFile, std::ios::binary | std::ios::trunc};
+
+            os.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+
+            std::uint32_t count = 0;
+
+            for (const auto &listing : listings) {
+                count += listing.second.used ? 1 : 0;
+            }
+
+            writeValue(os, count);
+
+            // the listings of directories no longer walked are left behind
+            for (const auto &listing : listings) {
+                if (! listing.second.used) {
+                    continue;
+                }
+
+                writeString(os, listing.first);
+                writeValue(os, listing.second.modifiedTime);
+                writeValue(os, listing.second.inode);
+                writeValue(os, static_cast<std::uint32_t>(listing.second.entries.size()));
+
+                for (const DirectoryEntry &entry : listing.second.entries) {
+                    writeValue(os, entry.type);
+                    writeString(os, entry.name);
+                }
+            }
+
+            if (! os.good()) {
+                std::remove(temporaryFile.c_str());
+                return;
+            }
+        }
+
+        std::rename(temporaryFile.c_str(), cacheFile.c_str());
+        changed = false;
+    }
+
+
+    void DirectoryCache::load() {
+        if (cacheFile.empty()) {
+            return;
+        }
+
+        std::ifstream is {cacheFile, std::ios::binary};
+        char magic[sizeof(CACHE_MAGIC)];
+        std::uint32_t count = 0;
+
+        if (! is.read(magic, sizeof(magic)) || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || !readValue(is, count)) {
+            return;
+        }
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            std::string path;
+            Listing listing;
+            std::uint32_t entryCount = 0;
+
+            if (! readString(is, path) || !readValue(is, listing.modifiedTime) || !readValue(is, listing.inode) || !readValue(is, entryCount) || entryCount > 1024 * 1024) {
+                // truncated: keep what was read so far
+                return;
+            }
+
+            listing.entries.resize(entryCount);
+
+            for (DirectoryEntry &entry : listing.entries) {
+                if (! readValue(is, entry.type) || !readString(is, entry.name)) {
+                    return;
+                }
+            }
+
+            listings[path] = std::move(listing);
+        }
+    }
+}
@@ -0,0 +1,83 @@
+
+#include <bok/core/FileState.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <bok/core/Hash.hpp>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+
+namespace bok {
+    std::optional<FileState> statFile(const std::string &path) {
+#ifdef STATX_MTIME
+        // asking for just what's needed spares some file systems (like network ones) the rest of the work
+        struct statx extended;
+
+        if (::statx(AT_FDCWD, path.c_str(), AT_STATX_SYNC_AS_STAT, STATX_MTIME | STATX_SIZE | STATX_INO, &extended) == 0) {
+            FileState state;
+            state.modifiedTime = static_cast<std::int64_t>(extended.stx_mtime.tv_sec) * 1000000000 + extended.stx_mtime.tv_nsec;
+            state.size = static_cast<std::uint64_t>(extended.stx_size);
+            state.inode = static_cast<std::uint64_t>(extended.stx_ino);
+
+            return state;
+        }
+
+        if (errno != ENOSYS) {
+            return {};
+        }
+#endif
+
+        struct stat result;
+
+        if (stat(path.c_str(), &result) != 0) {
+            return {};
+        }
+
+        FileState state;
+        state.modifiedTime = static_cast<std::int64_t>(result.st_mtim.tv_sec) * 1000000000 + result.st_mtim.tv_nsec;
+        state.size = static_cast<std::uint64_t>(result.st_size);
+        state.inode = static_cast<std::uint64_t>(result.st_ino);
+
+        return state;
+    }
+
+
+    std::optional<FileState> scanFile(const std::string &path) {
+        auto state = statFile(path);
+
+        if (! state) {
+            return {};
+        }
+
+        const auto hash = hashFile(path);
+
+        if (! hash) {
+            return {};
+        }
+
+        state->contentHash = *hash;
+
+        return state;
+    }
+
+
+    bool writeFileIfChanged(const std::string &path, const std::string &content) {
+        {
+            std::ifstream is {path};
+            std::stringstream current;
+            current << is.rdbuf();
+
+            if (is.good() && current.str() == content) {
+                return false;
+            }
+        }
+
+        std::ofstream os {path};
+        os << content;
+
+        return true;
+    }
+}
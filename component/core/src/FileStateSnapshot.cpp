@@ -0,0 +1,182 @@
+
+#include <bok/core/FileStateSnapshot.hpp>
+
+#include <algorithm>
+#include <bok/core/Hash.hpp>
+#include <bok/core/JobScheduler.hpp>
+
+
+namespace bok {
+    namespace {
+        // fewer paths than this aren't worth handing over to another thread
+        constexpr std::size_t MIN_BATCH_SIZE = 64;
+    }
+
+
+    std::optional<FileState> FileStateSnapshot::stat(const std::string &path) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (auto it = entries.find(path); it != entries.end()) {
+                return it->second.state;
+            }
+        }
+
+        const auto state = this->statUncached(path);
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        return entries.try_emplace(path, Entry{state, false}).first->second.state;
+    }
+
+
+    std::optional<FileState> FileStateSnapshot::scan(const std::string &path) {
+        auto state = this->stat(path);
+
+        if (! state) {
+            return {};
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (auto it = entries.find(path); it != entries.end() && it->second.hashed) {
+                return it->second.state;
+            }
+        }
+
+        const auto contentHash = hashFile(path);
+
+        if (! contentHash) {
+            return {};
+        }
+
+        // the stat may be from before a compile, during which the file could have been saved again: 
+        // pairing the old stat with the new content would hide that edit from the next build
+        if (const auto current = this->statUncached(path); !current || !current->sameStat(*state)) {
+            std::lock_guard<std::mutex> lock{mutex};
+            entries.erase(path);
+
+            return FileState{};
+        }
+
+        state->contentHash = *contentHash;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        entries[path] = Entry{state, true};
+
+        return state;
+    }
+
+
+    void FileStateSnapshot::prefetch(const std::vector<std::string> &paths, JobScheduler *scheduler) {
+        std::vector<std::string> missing;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            for (const std::string &path : paths) {
+                if (entries.find(path) == entries.end()) {
+                    missing.push_back(path);
+                }
+            }
+        }
+
+        std::sort(missing.begin(), missing.end());
+        missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+        auto statBatch = [this, &missing] (const std::size_t begin, const std::size_t end) {
+            std::vector<Entry> states;
+            states.reserve(end - begin);
+
+            for (std::size_t i = begin; i < end; i++) {
+                states.push_back(Entry{this->statUncached(missing[i]), false});
+            }
+
+            // one lock for the whole batch
+            std::lock_guard<std::mutex> lock{mutex};
+
+            for (std::size_t i = begin; i < end; i++) {
+                entries.try_emplace(missing[i], states[i - begin]);
+            }
+        };
+
+        const std::size_t workerCount = scheduler ? static_cast<std::size_t>(scheduler->getJobLimit()) : 1;
+
+        if (workerCount < 2 || missing.size() < 2 * MIN_BATCH_SIZE) {
+            statBatch(0, missing.size());
+            return;
+        }
+
+        // a few batches per worker, so a slow directory doesn't hold the rest back
+        const std::size_t batchSize = std::max(MIN_BATCH_SIZE, missing.size() / (workerCount * 4) + 1);
+
+        for (std::size_t begin = 0; begin < missing.size(); begin += batchSize) {
+            const std::size_t end = std::min(begin + batchSize, missing.size());
+
+            scheduler->submit([&statBatch, begin, end] () {
+                statBatch(begin, end);
+            });
+        }
+
+        scheduler->wait();
+    }
+
+
+    void FileStateSnapshot::invalidate(const std::string &path) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        entries.erase(path);
+    }
+
+
+    std::vector<std::string> FileStateSnapshot::refresh(const std::vector<std::string> &paths) {
+        std::vector<std::string> changed;
+
+        for (const std::string &path : paths) {
+            const auto state = this->statUncached(path);
+
+            std::lock_guard<std::mutex> lock{mutex};
+            Entry &entry = entries[path];
+
+            const bool same = (state && entry.state) 
+                ? state->sameStat(*entry.state) 
+                : state.has_value() == entry.state.has_value();
+
+            if (! same) {
+                changed.push_back(path);
+                entry = Entry{state, false};
+            }
+        }
+
+        return changed;
+    }
+
+
+    void FileStateSnapshot::clear() {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        entries.clear();
+    }
+
+
+    std::vector<std::string> FileStateSnapshot::getPaths() const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        std::vector<std::string> paths;
+        paths.reserve(entries.size());
+
+        for (const auto &entry : entries) {
+            paths.push_back(entry.first);
+        }
+
+        return paths;
+    }
+
+
+    std::optional<FileState> FileStateSnapshot::statUncached(const std::string &path) {
+        statCount++;
+
+        return statFile(path);
+    }
+}
@@ -0,0 +1,125 @@
+
+#include <bok/core/FileWatcher.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+
+namespace bok {
+    namespace {
+        // editors save files in place, through a temporary file that gets renamed, or by deleting them first
+        constexpr std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE 
+            | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    }
+
+
+    FileWatcher::FileWatcher() {
+        fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+        if (fd < 0) {
+            throw std::runtime_error("Couldn't initialize inotify: " + std::string{std::strerror(errno)});
+        }
+    }
+
+
+    FileWatcher::~FileWatcher() {
+        ::close(fd);
+    }
+
+
+    bool FileWatcher::watch(const std::string &file) {
+        if (this->isWatching(file)) {
+            return true;
+        }
+
+        const std::filesystem::path path = std::filesystem::path{file}.lexically_normal();
+        const std::string directory = path.has_parent_path() ? path.parent_path().string() : ".";
+
+        // the same directory always gets the same watch descriptor, however it's spelled
+        const int wd = ::inotify_add_watch(fd, directory.c_str(), WATCH_MASK);
+
+        if (wd < 0) {
+            return false;
+        }
+
+        directories[wd][path.filename().string()].push_back(file);
+        watchedFiles.insert(file);
+
+        return true;
+    }
+
+
+    std::vector<std::string> FileWatcher::readChanges(bool &overflowed) {
+        std::vector<std::string> changes;
+        std::set<std::string> reported;
+        alignas(inotify_event) char buffer[64 * 1024];
+
+        overflowed = false;
+
+        while (true) {
+            const ssize_t length = ::read(fd, buffer, sizeof(buffer));
+
+            if (length <= 0) {
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < length; ) {
+                const auto *event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    overflowed = true;
+                    continue;
+                }
+
+                const auto directory = directories.find(event->wd);
+
+                if (directory == directories.end()) {
+                    continue;
+                }
+
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                    // the directory itself is gone: every file in it changed, and must be watched again
+                    for (const auto &name : directory->second) {
+                        for (const std::string &file : name.second) {
+                            watchedFiles.erase(file);
+
+                            if (reported.insert(file).second) {
+                                changes.push_back(file);
+                            }
+                        }
+                    }
+
+                    if (event->mask & IN_IGNORED) {
+                        directories.erase(directory);
+                    }
+
+                    continue;
+                }
+
+                if (event->len == 0) {
+                    continue;
+                }
+
+                const auto name = directory->second.find(event->name);
+
+                if (name == directory->second.end()) {
+                    continue;
+                }
+
+                for (const std::string &file : name->second) {
+                    if (reported.insert(file).second) {
+                        changes.push_back(file);
+                    }
+                }
+            }
+        }
+
+        return changes;
+    }
+}
@@ -0,0 +1,339 @@
+
+#include <bok/core/Glob.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <bok/core/DirectoryCache.hpp>
+#include <bok/core/JobScheduler.hpp>
+
+
+namespace bok {
+    namespace {
+        struct LinuxDirent64 {
+            ino64_t d_ino;
+            off64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[];
+        };
+
+
+        std::vector<std::string> splitPath(const std::string &path) {
+            std::vector<std::string> segments;
+            std::size_t begin = 0;
+
+            while (begin <= path.size()) {
+                std::size_t end = path.find('/', begin);
+
+                if (end == std::string::npos) {
+                    end = path.size();
+                }
+
+                if (end > begin && path.compare(begin, end - begin, ".") != 0) {
+                    segments.push_back(path.substr(begin, end - begin));
+                }
+
+                begin = end + 1;
+            }
+
+            return segments;
+        }
+
+
+        bool matchSegment(const char *pattern, const char *name) {
+            // on a mismatch, the last '*' seen takes one more character and the rest is tried again
+            const char *star = nullptr;
+            const char *retry = nullptr;
+
+            while (*name) {
+                if (*pattern == '?' || (*pattern == *name && *pattern != '*')) {
+                    pattern++;
+                    name++;
+                } else if (*pattern == '*') {
+                    star = pattern++;
+                    retry = name;
+                } else if (star) {
+                    pattern = star + 1;
+                    name = ++retry;
+                } else {
+                    return false;
+                }
+            }
+
+            while (*pattern == '*') {
+                pattern++;
+            }
+
+            return *pattern == '\0';
+        }
+
+
+        bool matchSegments(const std::vector<std::string> &pattern, const std::size_t p, const std::vector<std::string> &path, const std::size_t s) {
+            if (p == pattern.size()) {
+                return s == path.size();
+            }
+
+            if (pattern[p] == "**") {
+                for (std::size_t next = s; next <= path.size(); next++) {
+                    if (matchSegments(pattern, p + 1, path, next)) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            return s < path.size() 
+                && matchSegment(pattern[p].c_str(), path[s].c_str()) 
+                && matchSegments(pattern, p + 1, path, s + 1);
+        }
+
+
+        /**
+         * Whether anything under the directory 'path' could match 'pattern'.
+         */
+        bool couldMatchUnder(const std::vector<std::string> &pattern, const std::vector<std::string> &path) {
+            for (std::size_t i = 0; i < path.size(); i++) {
+                if (i < pattern.size() && pattern[i] == "**") {
+                    return true;
+                }
+
+                // the last segment of the pattern names files
+                if (i + 1 >= pattern.size() || !matchSegment(pattern[i].c_str(), path[i].c_str())) {
+                    return false;
+                }
+            }
+
+            return path.size() < pattern.size();
+        }
+
+
+        std::optional<std::vector<DirectoryEntry>> readDirectory(const int pathFd) {
+            const int fd = ::openat(pathFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+            if (fd < 0) {
+                return {};
+            }
+
+            std::vector<DirectoryEntry> entries;
+            alignas(LinuxDirent64) char buffer[32 * 1024];
+
+            while (true) {
+                const long length = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+
+                if (length < 0) {
+                    // a partial listing would be taken (and cached) as the whole directory
+                    ::close(fd);
+                    return {};
+                }
+
+                if (length == 0) {
+                    break;
+                }
+
+                for (long offset = 0; offset < length; ) {
+                    const auto *dirent = reinterpret_cast<const LinuxDirent64*>(buffer + offset);
+                    offset += dirent->d_reclen;
+
+                    // hidden entries, along with '.' and '..'
+                    if (dirent->d_name[0] == '.') {
+                        continue;
+                    }
+
+                    DirectoryEntry entry {dirent->d_name, DirectoryEntry::Type::Other};
+
+                    if (dirent->d_type == DT_REG) {
+                        entry.type = DirectoryEntry::Type::File;
+                    } else if (dirent->d_type == DT_DIR) {
+                        entry.type = DirectoryEntry::Type::Directory;
+                    } else if (dirent->d_type == DT_LNK || dirent->d_type == DT_UNKNOWN) {
+                        // not every file system fills the type in; links are resolved, but never walked into
+                        struct stat info;
+
+                        if (::fstatat(fd, dirent->d_name, &info, 0) == 0) {
+                            if (S_ISREG(info.st_mode)) {
+                                entry.type = DirectoryEntry::Type::File;
+                            } else if (S_ISDIR(info.st_mode) && dirent->d_type == DT_UNKNOWN) {
+                                entry.type = DirectoryEntry::Type::Directory;
+                            }
+                        }
+                    }
+
+                    entries.push_back(std::move(entry));
+                }
+            }
+
+            ::close(fd);
+
+            return entries;
+        }
+
+
+        struct Directory {
+            int fd = -1;                        // opened with O_PATH, only to open its entries relative to it
+            std::string path;                   // relative to the root
+            std::vector<std::string> segments;
+
+            ~Directory() {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+        };
+
+
+        class GlobWalk {
+        public:
+            GlobWalk(const std::string &root, const std::vector<std::string> &patterns, DirectoryCache *cache, JobScheduler *scheduler) {
+                this->root = root;
+                this->cache = cache;
+                this->scheduler = scheduler;
+
+                for (const std::string &pattern : patterns) {
+                    this->patterns.push_back(splitPath(pattern));
+                }
+            }
+
+
+            std::vector<std::string> run() {
+                auto directory = std::make_shared<Directory>();
+                directory->fd = ::open(root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+                if (directory->fd < 0) {
+                    return {};
+                }
+
+                this->visit(directory);
+                directory.reset();
+
+                if (scheduler) {
+                    scheduler->wait();
+                }
+
+                std::sort(files.begin(), files.end());
+                files.erase(std::unique(files.begin(), files.end()), files.end());
+
+                return files;
+            }
+
+        private:
+            void walk(const std::shared_ptr<Directory> &parent, const std::string &name) {
+                auto directory = std::make_shared<Directory>();
+                directory->fd = ::openat(parent->fd, name.c_str(), O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+                if (directory->fd < 0) {
+                    return;
+                }
+
+                directory->path = parent->path.empty() ? name : parent->path + "/" + name;
+                directory->segments = parent->segments;
+                directory->segments.push_back(name);
+
+                this->visit(directory);
+            }
+
+
+            void visit(const std::shared_ptr<Directory> &directory) {
+                struct stat info;
+
+                if (::fstat(directory->fd, &info) != 0) {
+                    return;
+                }
+
+                const std::int64_t modifiedTime = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+                const std::uint64_t inode = static_cast<std::uint64_t>(info.st_ino);
+                const std::string key = (std::filesystem::path{root} / directory->path).lexically_normal().string();
+
+                std::optional<std::vector<DirectoryEntry>> entries = cache ? cache->find(key, modifiedTime, inode) : std::nullopt;
+
+                if (! entries) {
+                    entries = readDirectory(directory->fd);
+
+                    if (! entries) {
+                        return;
+                    }
+
+                    if (cache) {
+                        cache->store(key, modifiedTime, inode, *entries);
+                    }
+                }
+
+                std::vector<std::string> matches;
+                std::vector<std::string> segments = directory->segments;
+
+                for (const DirectoryEntry &entry : *entries) {
+                    segments.push_back(entry.name);
+
+                    if (entry.type == DirectoryEntry::Type::File && this->matches(segments)) {
+                        matches.push_back(directory->path.empty() ? entry.name : directory->path + "/" + entry.name);
+                    } else if (entry.type == DirectoryEntry::Type::Directory && this->matchesUnder(segments)) {
+                        if (scheduler) {
+                            // the job keeps the parent open until the child is opened, relative to it
+                            scheduler->submit([this, directory, name = entry.name] () {
+                                this->walk(directory, name);
+                            });
+                        } else {
+                            this->walk(directory, entry.name);
+                        }
+                    }
+
+                    segments.pop_back();
+                }
+
+                if (! matches.empty()) {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    files.insert(files.end(), matches.begin(), matches.end());
+                }
+            }
+
+
+            bool matches(const std::vector<std::string> &segments) const {
+                return std::any_of(patterns.begin(), patterns.end(), [&segments] (const std::vector<std::string> &pattern) {
+                    return matchSegments(pattern, 0, segments, 0);
+                });
+            }
+
+
+            bool matchesUnder(const std::vector<std::string> &segments) const {
+                return std::any_of(patterns.begin(), patterns.end(), [&segments] (const std::vector<std::string> &pattern) {
+                    return couldMatchUnder(pattern, segments);
+                });
+            }
+
+        private:
+            std::string root;
+            std::vector<std::vector<std::string>> patterns;
+            DirectoryCache *cache = nullptr;
+            JobScheduler *scheduler = nullptr;
+
+            std::mutex mutex;
+            std::vector<std::string> files;
+        };
+    }
+
+
+    bool isGlobPattern(const std::string &value) {
+        return value.find_first_of("*?") != std::string::npos;
+    }
+
+
+    bool matchGlob(const std::string &pattern, const std::string &path) {
+        return matchSegments(splitPath(pattern), 0, splitPath(path), 0);
+    }
+
+
+    std::vector<std::string> expandGlobs(const std::string &root, const std::vector<std::string> &patterns, DirectoryCache *cache, JobScheduler *scheduler) {
+        GlobWalk walk {root.empty() ? "." : root, patterns, cache, scheduler};
+
+        return walk.run();
+    }
+}
@@ -0,0 +1,138 @@
+
+#include <bok/core/Hash.hpp>
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+namespace bok {
+    namespace {
+        constexpr std::uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+        constexpr std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr std::uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+        constexpr std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr std::uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+        inline std::uint64_t rotl(const std::uint64_t value, const int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        inline std::uint64_t read64(const unsigned char *ptr) {
+            std::uint64_t value;
+            std::memcpy(&value, ptr, sizeof(value));
+            return value;
+        }
+
+        inline std::uint32_t read32(const unsigned char *ptr) {
+            std::uint32_t value;
+            std::memcpy(&value, ptr, sizeof(value));
+            return value;
+        }
+
+        inline std::uint64_t round(std::uint64_t acc, const std::uint64_t input) {
+            acc += input * PRIME2;
+            acc = rotl(acc, 31);
+            return acc * PRIME1;
+        }
+
+        inline std::uint64_t mergeRound(std::uint64_t acc, const std::uint64_t value) {
+            acc ^= round(0, value);
+            return acc * PRIME1 + PRIME4;
+        }
+    }
+
+
+    std::uint64_t hashBytes(const void *data, const std::size_t size, const std::uint64_t seed) {
+        const unsigned char *ptr = static_cast<const unsigned char*>(data);
+        const unsigned char *end = ptr + size;
+        std::uint64_t hash;
+
+        if (size >= 32) {
+            std::uint64_t v1 = seed + PRIME1 + PRIME2;
+            std::uint64_t v2 = seed + PRIME2;
+            std::uint64_t v3 = seed;
+            std::uint64_t v4 = seed - PRIME1;
+
+            const unsigned char *limit = end - 32;
+
+            do {
+                v1 = round(v1, read64(ptr)); ptr += 8;
+                v2 = round(v2, read64(ptr)); ptr += 8;
+                v3 = round(v3, read64(ptr)); ptr += 8;
+                v4 = round(v4, read64(ptr)); ptr += 8;
+            } while (ptr <= limit);
+
+            hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            hash = mergeRound(hash, v1);
+            hash = mergeRound(hash, v2);
+            hash = mergeRound(hash, v3);
+            hash = mergeRound(hash, v4);
+        } else {
+            hash = seed + PRIME5;
+        }
+
+        hash += static_cast<std::uint64_t>(size);
+
+        while (ptr + 8 <= end) {
+            hash ^= round(0, read64(ptr));
+            hash = rotl(hash, 27) * PRIME1 + PRIME4;
+            ptr += 8;
+        }
+
+        if (ptr + 4 <= end) {
+            hash ^= static_cast<std::uint64_t>(read32(ptr)) * PRIME1;
+            hash = rotl(hash, 23) * PRIME2 + PRIME3;
+            ptr += 4;
+        }
+
+        while (ptr < end) {
+            hash ^= (*ptr) * PRIME5;
+            hash = rotl(hash, 11) * PRIME1;
+            ptr++;
+        }
+
+        hash ^= hash >> 33;
+        hash *= PRIME2;
+        hash ^= hash >> 29;
+        hash *= PRIME3;
+        hash ^= hash >> 32;
+
+        return hash;
+    }
+
+
+    std::optional<std::uint64_t> hashFile(const std::string &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) {
+            return {};
+        }
+
+        struct stat info;
+
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            return {};
+        }
+
+        if (info.st_size == 0) {
+            ::close(fd);
+            return hashBytes(nullptr, 0);
+        }
+
+        void *data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (data == MAP_FAILED) {
+            return {};
+        }
+
+        const std::uint64_t hash = hashBytes(data, static_cast<std::size_t>(info.st_size));
+        ::munmap(data, static_cast<std::size_t>(info.st_size));
+
+        return hash;
+    }
+}
@@ -0,0 +1,263 @@
+
+#include <bok/core/IncludeScanner.hpp>
+
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <filesystem>
+#include <set>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <bok/core/Hash.hpp>
+
+
+namespace bok {
+    namespace {
+        bool isBlank(const char c) {
+            return c == ' ' || c == '\t';
+        }
+
+
+        const char* skipBlanks(const char *current, const char *end) {
+            while (current < end && isBlank(*current)) {
+                current++;
+            }
+
+            return current;
+        }
+
+
+        /**
+         * The content of the regular file 'path'. Headers are small, so reading them beats mapping them.
+         */
+        std::optional<std::string> readFile(const std::string &path) {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (fd < 0) {
+                return {};
+            }
+
+            struct stat info;
+
+            if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+                ::close(fd);
+                return {};
+            }
+
+            std::string content(static_cast<std::size_t>(info.st_size), '\0');
+            std::size_t offset = 0;
+
+            while (offset < content.size()) {
+                const ssize_t count = ::read(fd, content.data() + offset, content.size() - offset);
+
+                if (count <= 0) {
+                    break;
+                }
+
+                offset += static_cast<std::size_t>(count);
+            }
+
+            ::close(fd);
+            content.resize(offset);
+
+            return content;
+        }
+    }
+
+
+    std::vector<IncludeDirective> IncludeScanner::scan(std::string_view content) {
+        std::vector<IncludeDirective> includes;
+
+        const char *begin = content.data();
+        const char *end = begin + content.size();
+        const char *current = begin;
+
+        while (current < end) {
+            const char *hash = static_cast<const char*>(std::memchr(current, '#', end - current));
+
+            if (hash == nullptr) {
+                break;
+            }
+
+            const char *lineEnd = static_cast<const char*>(std::memchr(hash, '\n', end - hash));
+
+            if (lineEnd == nullptr) {
+                lineEnd = end;
+            }
+
+            current = lineEnd;
+
+            // a directive has nothing but blanks before the '#'
+            const char *lineStart = hash;
+
+            while (lineStart > begin && isBlank(lineStart[-1])) {
+                lineStart--;
+            }
+
+            if (lineStart > begin && lineStart[-1] != '\n') {
+                // like a '#' in a string: the rest of the line may still hold one that counts
+                current = hash + 1;
+                continue;
+            }
+
+            const char *directive = skipBlanks(hash + 1, lineEnd);
+            constexpr std::string_view INCLUDE = "include";
+
+            if (static_cast<std::size_t>(lineEnd - directive) <= INCLUDE.size() || std::memcmp(directive, INCLUDE.data(), INCLUDE.size()) != 0) {
+                continue;
+            }
+
+            const char *open = skipBlanks(directive + INCLUDE.size(), lineEnd);
+
+            if (open == lineEnd || (*open != '"' && *open != '<')) {
+                continue;
+            }
+
+            const char *close = static_cast<const char*>(std::memchr(open + 1, *open == '<' ? '>' : '"', lineEnd - open - 1));
+
+            if (close == nullptr) {
+                continue;
+            }
+
+            includes.push_back({std::string{open + 1, close}, *open == '<'});
+        }
+
+        return includes;
+    }
+
+
+    std::shared_ptr<const std::vector<IncludeDirective>> IncludeScanner::getIncludes(const std::string &file) {
+        const std::optional<FileEntry> entry = this->findEntry(file);
+
+        return entry ? entry->includes : nullptr;
+    }
+
+
+    std::vector<IncludeScanner::Closure> IncludeScanner::findClosures(const std::vector<std::string> &sources, const std::vector<std::string> &includeDirectories) {
+        // every file is looked at once, and the same include from the same directory resolves the same way
+        std::unordered_map<std::string, std::optional<FileEntry>> entries;
+        std::unordered_map<std::string, std::string> resolved;
+
+        auto findEntry = [this, &entries] (const std::string &file) -> const std::optional<FileEntry>& {
+            auto [it, inserted] = entries.try_emplace(file);
+
+            if (inserted) {
+                it->second = this->findEntry(file);
+            }
+
+            return it->second;
+        };
+
+        auto resolve = [&] (const std::string &directory, const IncludeDirective &include) -> const std::string& {
+            auto [it, inserted] = resolved.try_emplace((include.system ? "<" : directory + "\"") + include.header);
+            std::string &path = it->second;
+
+            if (! inserted) {
+                return path;
+            }
+
+            if (! include.system) {
+                if (std::string candidate = (std::filesystem::path{directory} / include.header).lexically_normal().string(); findEntry(candidate)) {
+                    path = std::move(candidate);
+                    return path;
+                }
+            }
+
+            for (const std::string &includeDirectory : includeDirectories) {
+                if (std::string candidate = (std::filesystem::path{includeDirectory} / include.header).lexically_normal().string(); findEntry(candidate)) {
+                    path = std::move(candidate);
+                    break;
+                }
+            }
+
+            return path;
+        };
+
+        std::vector<Closure> closures;
+        closures.reserve(sources.size());
+
+        for (const std::string &source : sources) {
+            Closure closure;
+            std::set<std::string> visited {source};
+            std::vector<std::string> pending {source};
+
+            while (! pending.empty()) {
+                const std::string file = std::move(pending.back());
+                pending.pop_back();
+
+                const std::optional<FileEntry> &entry = findEntry(file);
+                closure.files.push_back(file);
+
+                if (! entry) {
+                    continue;
+                }
+
+                closure.size += entry->state.size;
+
+                const std::string directory = std::filesystem::path{file}.parent_path().string();
+
+                for (const IncludeDirective &include : *entry->includes) {
+                    const std::string &header = resolve(directory, include);
+
+                    if (header.empty()) {
+                        closure.unresolvedCount++;
+                    } else if (visited.insert(header).second) {
+                        pending.push_back(header);
+                    }
+                }
+            }
+
+            closures.push_back(std::move(closure));
+        }
+
+        return closures;
+    }
+
+
+    std::optional<IncludeScanner::FileEntry> IncludeScanner::findEntry(const std::string &file) {
+        const std::optional<FileState> state = statFile(file);
+
+        if (! state) {
+            return {};
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            // a file rewritten within the same timestamp goes unnoticed, which is fine for estimates
+            if (auto it = files.find(file); it != files.end() && it->second.state.sameStat(*state)) {
+                return it->second;
+            }
+        }
+
+        const std::optional<std::string> content = readFile(file);
+
+        if (! content) {
+            return {};
+        }
+
+        const std::uint64_t contentHash = hashString(*content);
+        std::shared_ptr<const std::vector<IncludeDirective>> includes;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (auto it = scans.find(contentHash); it != scans.end()) {
+                includes = it->second;
+            }
+        }
+
+        if (! includes) {
+            includes = std::make_shared<const std::vector<IncludeDirective>>(scan(*content));
+            scanCount++;
+        }
+
+        FileEntry entry {*state, includes};
+
+        std::lock_guard<std::mutex> lock{mutex};
+        scans.emplace(contentHash, includes);
+        files[file] = entry;
+
+        return entry;
+    }
+}
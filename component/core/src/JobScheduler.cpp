@@ -0,0 +1,171 @@
+
+#include <bok/core/JobScheduler.hpp>
+
+
+namespace bok {
+    namespace {
+        // lets jobs submitted from a worker thread land in that worker's own deque
+        thread_local const JobScheduler *currentScheduler = nullptr;
+        thread_local std::size_t currentWorker = 0;
+    }
+
+
+    JobScheduler::JobScheduler(const int jobLimit, const bool keepGoing) {
+        this->keepGoing = keepGoing;
+
+        std::size_t workerCount = jobLimit > 0 ? static_cast<std::size_t>(jobLimit) : std::thread::hardware_concurrency();
+
+        if (workerCount == 0) {
+            workerCount = 1;
+        }
+
+        for (std::size_t i = 0; i < workerCount; i++) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+
+        for (std::size_t i = 0; i < workerCount; i++) {
+            workers[i]->thread = std::thread{&JobScheduler::workerMain, this, i};
+        }
+    }
+
+
+    JobScheduler::~JobScheduler() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+
+        workAvailable.notify_all();
+
+        for (auto &worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+
+    void JobScheduler::submit(Job job) {
+        const std::size_t index = (currentScheduler == this)
+            ? currentWorker
+            : nextWorker++ % workers.size();
+
+        {
+            std::lock_guard<std::mutex> lock{workers[index]->mutex};
+            workers[index]->jobs.push_back(std::move(job));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            queuedJobs++;
+        }
+
+        workAvailable.notify_one();
+    }
+
+
+    void JobScheduler::wait() {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        idle.wait(lock, [this] () {
+            return queuedJobs == 0 && activeJobs == 0;
+        });
+    }
+
+
+    void JobScheduler::rethrowFailure() const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (firstFailure) {
+            std::rethrow_exception(firstFailure);
+        }
+    }
+
+
+    void JobScheduler::workerMain(const std::size_t index) {
+        currentScheduler = this;
+        currentWorker = index;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+
+                workAvailable.wait(lock, [this] () {
+                    return stopping || queuedJobs > 0;
+                });
+
+                if (queuedJobs == 0) {
+                    return;
+                }
+
+                // the job counted here is already sitting in one of the deques
+                queuedJobs--;
+                activeJobs++;
+            }
+
+            Job job;
+
+            while (! this->popJob(index, job)) {
+                std::this_thread::yield();
+            }
+
+            this->runJob(job);
+
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                activeJobs--;
+
+                if (queuedJobs == 0 && activeJobs == 0) {
+                    idle.notify_all();
+                }
+            }
+        }
+    }
+
+
+    bool JobScheduler::popJob(const std::size_t index, Job &job) {
+        {
+            Worker &own = *workers[index];
+            std::lock_guard<std::mutex> lock{own.mutex};
+
+            if (! own.jobs.empty()) {
+                job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+
+                return true;
+            }
+        }
+
+        for (std::size_t i = 1; i < workers.size(); i++) {
+            Worker &victim = *workers[(index + i) % workers.size()];
+            std::lock_guard<std::mutex> lock{victim.mutex};
+
+            if (! victim.jobs.empty()) {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    void JobScheduler::runJob(Job &job) {
+        if (failureCount > 0 && !keepGoing) {
+            // cancelled
+            return;
+        }
+
+        try {
+            job();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (! firstFailure) {
+                firstFailure = std::current_exception();
+            }
+
+            failureCount++;
+        }
+    }
+}
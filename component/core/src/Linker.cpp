@@ -1,34 +1,171 @@
 
 #include <bok/core/Linker.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <filesystem>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+#include <bok/core/FileState.hpp>
 
 
 namespace bok {
-    LinkerOutput Linker::link(const std::string &name, const std::string &outputFilePath, const std::vector<std::string> &objects) const {
+    LinkerOutput Linker::link(const std::string &, const std::string &outputFilePath, const std::vector<std::string> &objects, const std::vector<std::string> &libraries) const {
+        Command command = this->createLinkCommand(objects, libraries);
+
+        return LinkerOutput {
+            objects,
+            outputFilePath,
+            command
+                .addArg("-lm")
+                .addArg("-o")
+                .addArg(outputFilePath)
+        };
+    }
+
+
+    LinkerOutput Linker::linkSharedLibrary(const std::string &, const std::string &outputFilePath, const std::vector<std::string> &objects, const std::vector<std::string> &libraries) const {
+        Command command = this->createLinkCommand(objects, libraries);
+
+        LinkerOutput output {
+            objects,
+            outputFilePath,
+            command
+                .addArg("-lm")
+                .addArg("-shared")
+                .addArg("-Wl,-soname," + std::filesystem::path(outputFilePath).filename().string())
+                .addArg("-o")
+                .addArg(outputFilePath)
+        };
+
+        output.interfaceFile = outputFilePath + ".toc";
+
+        return output;
+    }
+
+
+    LinkerOutput Linker::archive(const std::string &, const std::string &outputFilePath, const std::vector<std::string> &objects) const {
+        assert(objects.size());
+
+        // 'D' leaves timestamps and owners out, so the same objects give the same archive
+        Command command("ar");
+        command
+            .allowResponseFile()
+            .addArg("rcsDT")
+            .addArg(outputFilePath);
+
+        for (const std::string &object : objects) {
+            command.addArg(object);
+        }
+
+        return LinkerOutput {objects, outputFilePath, command};
+    }
+
+
+    Command Linker::createLinkCommand(const std::vector<std::string> &objects, const std::vector<std::string> &libraries) const {
         assert(objects.size());
 
         Command command("gcc");
+        command.allowResponseFile();
 
         for (const std::string &object : objects) {
             command.addArg(object);
         }
 
+        std::set<std::string> libraryDirectories;
+
+        for (const std::string &library : libraries) {
+            command.addArg(library);
+
+            // so shared libraries are found where they were built, without installing them
+            if (std::filesystem::path(library).extension() == ".so") {
+                const std::string directory = std::filesystem::absolute(library).parent_path().string();
+
+                if (libraryDirectories.insert(directory).second) {
+                    command.addArg("-Wl,-rpath," + directory);
+                }
+            }
+        }
+
+        if (! linkerFlavor.empty()) {
+            command.addArg("-fuse-ld=" + linkerFlavor);
+        }
+
+        for (const std::string &flag : flags) {
+            command.addArg(flag);
+        }
+
         bool is_macOS = false;
 
         if (is_macOS) {
-            command.addArg("-macosx_version_min " "10.14");
+            command.addArg("-macosx_version_min").addArg("10.14");
             command.addArg("-lc++");
         } else {
             command.addArg("-lstdc++");
         }
 
-        return LinkerOutput {
-            objects,
-            outputFilePath,
-            command
-                .addArg("-lm")
-                .addArg("-o " + outputFilePath)
-        };
+        return command;
+    }
+
+
+    std::string Linker::findFastLinker() {
+        const char *path = std::getenv("PATH");
+
+        for (const std::string flavor : {"mold", "lld"}) {
+            std::stringstream ss {path ? path : ""};
+            std::string entry;
+
+            while (std::getline(ss, entry, ':')) {
+                if (::access((entry + "/ld." + flavor).c_str(), X_OK) == 0) {
+                    return flavor;
+                }
+            }
+        }
+
+        return "";
+    }
+
+
+    bool Linker::writeInterface(const std::string &library, const std::string &interfaceFile) {
+        Command command("nm");
+        command
+            .addArg("--dynamic")
+            .addArg("--defined-only")
+            .addArg("--extern-only")
+            .addArg("--format=posix")
+            .addArg(library);
+
+        // like "name type value size": the addresses move with every change, so they're left out
+        std::stringstream ss {command.execute().standardOutput};
+        std::vector<std::string> symbols;
+        std::string line;
+
+        while (std::getline(ss, line)) {
+            std::stringstream fields {line};
+            std::string symbol, type, value, size;
+
+            if (! (fields >> symbol >> type)) {
+                continue;
+            }
+
+            fields >> value >> size;
+
+            // the layout of data is part of the interface, the length of code isn't
+            const bool data = std::string{"BbDdGgRrSsVv"}.find(type[0]) != std::string::npos;
+
+            symbols.push_back(symbol + " " + type + (data ? " " + size : ""));
+        }
+
+        std::sort(symbols.begin(), symbols.end());
+
+        std::string content;
+
+        for (const std::string &symbol : symbols) {
+            content += symbol + "\n";
+        }
+
+        return writeFileIfChanged(interfaceFile, content);
     }
 }
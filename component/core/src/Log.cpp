@@ -0,0 +1,279 @@
+
+#include <bok/core/Log.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+
+namespace bok {
+    namespace {
+        // a power of two, so positions map to slots with a mask
+        const std::size_t LOG_CAPACITY = 4096;
+
+        const auto WRITER_IDLE_TIMEOUT = std::chrono::milliseconds(50);
+
+        bool isTerminal() {
+            const char *term = std::getenv("TERM");
+
+            return ::isatty(STDOUT_FILENO) && term != nullptr && std::strcmp(term, "dumb") != 0;
+        }
+
+
+        std::size_t getTerminalWidth() {
+            winsize size {};
+
+            if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+                return size.ws_col;
+            }
+
+            return 80;
+        }
+    }
+
+
+    Log::Log() {
+        capacity = LOG_CAPACITY;
+        slots = std::make_unique<Slot[]>(capacity);
+
+        for (std::size_t i = 0; i < capacity; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        output = &std::cout;
+        errors = &std::cerr;
+        this->updateStatusLine();
+
+        writer = std::thread{&Log::writerMain, this};
+    }
+
+
+    Log::~Log() {
+        {
+            std::lock_guard<std::mutex> lock{writerMutex};
+            stopping = true;
+        }
+
+        wake.notify_one();
+        writer.join();
+    }
+
+
+    void Log::write(const LogLevel level, std::string text) {
+        if (! this->isEnabled(level)) {
+            return;
+        }
+
+        this->push({RecordType::Text, level, std::move(text)}, level > LogLevel::Info);
+    }
+
+
+    void Log::setStatus(std::string status) {
+        if (! this->hasStatusLine()) {
+            return;
+        }
+
+        // only the latest status matters, so losing one to a full queue is harmless
+        this->push({RecordType::Status, LogLevel::Info, std::move(status)}, true);
+    }
+
+
+    void Log::redirect(std::ostream *stream) {
+        this->flush();
+
+        {
+            std::lock_guard<std::mutex> lock{writerMutex};
+
+            this->clearStatus();
+            status.clear();
+
+            output = stream ? stream : &std::cout;
+            errors = stream ? stream : &std::cerr;
+        }
+
+        this->updateStatusLine();
+    }
+
+
+    void Log::flush() {
+        const std::size_t target = enqueuePosition.load(std::memory_order_acquire);
+
+        std::unique_lock<std::mutex> lock{writerMutex};
+        wake.notify_one();
+
+        written.wait(lock, [this, target] () {
+            return writtenPosition >= target;
+        });
+    }
+
+
+    Log& Log::getDefault() {
+        static Log log;
+
+        return log;
+    }
+
+
+    bool Log::tryPush(Record &record) {
+        std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+
+        while (true) {
+            Slot &slot = slots[position & (capacity - 1)];
+            const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.record = std::move(record);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+
+                    return true;
+                }
+            } else if (difference < 0) {
+                // full: the writer has not released this slot yet
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+
+    bool Log::tryPop(Record &record) {
+        Slot &slot = slots[dequeuePosition & (capacity - 1)];
+        const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if (sequence != dequeuePosition + 1) {
+            return false;
+        }
+
+        record = std::move(slot.record);
+        slot.sequence.store(dequeuePosition + capacity, std::memory_order_release);
+        dequeuePosition++;
+
+        return true;
+    }
+
+
+    void Log::push(Record record, const bool mayDrop) {
+        while (! this->tryPush(record)) {
+            if (mayDrop) {
+                droppedCount++;
+                return;
+            }
+
+            wake.notify_one();
+            std::this_thread::yield();
+        }
+
+        // pairs with the fence in writerMain, so either the writer sees the record or we see it asleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (writerSleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock{writerMutex};
+            wake.notify_one();
+        }
+    }
+
+
+    void Log::writerMain() {
+        std::unique_lock<std::mutex> lock{writerMutex};
+
+        while (true) {
+            this->writeBatch();
+
+            writtenPosition = dequeuePosition;
+            written.notify_all();
+
+            if (stopping && enqueuePosition.load(std::memory_order_acquire) == dequeuePosition) {
+                break;
+            }
+
+            writerSleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            const Slot &next = slots[dequeuePosition & (capacity - 1)];
+
+            if (next.sequence.load(std::memory_order_acquire) != dequeuePosition + 1 && !stopping) {
+                wake.wait_for(lock, WRITER_IDLE_TIMEOUT);
+            }
+
+            writerSleeping.store(false, std::memory_order_relaxed);
+        }
+
+        this->clearStatus();
+        output->flush();
+    }
+
+
+    void Log::writeBatch() {
+        Record record;
+        bool outputWritten = false;
+        bool errorsWritten = false;
+        bool statusChanged = false;
+
+        while (this->tryPop(record)) {
+            if (record.type == RecordType::Status) {
+                status = std::move(record.text);
+                statusChanged = true;
+                continue;
+            }
+
+            this->clearStatus();
+
+            if (record.level <= LogLevel::Warning) {
+                *errors << record.text;
+                errorsWritten = true;
+            } else {
+                *output << record.text;
+                outputWritten = true;
+            }
+        }
+
+        if (statusChanged && status.empty()) {
+            this->clearStatus();
+        }
+
+        if (errorsWritten) {
+            errors->flush();
+        }
+
+        if ((outputWritten || errorsWritten || statusChanged) && !status.empty()) {
+            this->drawStatus();
+        }
+
+        if (outputWritten || errorsWritten || statusChanged) {
+            output->flush();
+        }
+    }
+
+
+    void Log::clearStatus() {
+        if (statusShown) {
+            *output << "\r\033[K" << std::flush;
+            statusShown = false;
+        }
+    }
+
+
+    void Log::drawStatus() {
+        if (! this->hasStatusLine()) {
+            return;
+        }
+
+        // a wrapped status line could not be erased with a carriage return
+        const std::size_t width = getTerminalWidth() - 1;
+
+        *output << "\r\033[K" << (status.size() > width ? status.substr(0, width) : status);
+        statusShown = true;
+    }
+
+
+    void Log::updateStatusLine() {
+        statusLine.store(output == &std::cout && isTerminal(), std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,477 @@
+
+#include <bok/core/ObjectCache.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <bok/core/Compiler.hpp>
+#include <bok/core/DepFile.hpp>
+#include <bok/core/FileState.hpp>
+#include <bok/core/Hash.hpp>
+
+
+namespace bok {
+    namespace {
+        constexpr const char *KEY_VERSION = "bok-object-cache-1";
+
+        // manifests keep only the most recent header sets seen for a given source and command line
+        constexpr std::size_t MAX_MANIFEST_ENTRIES = 16;
+
+        std::string toHex(const std::uint64_t value) {
+            char buffer[17];
+            std::snprintf(buffer, sizeof(buffer), "%016" PRIx64, value);
+            return buffer;
+        }
+
+        /**
+         * Advisory, exclusive lock on a file, shared by every process using the same store.
+         */
+        class FileLock {
+        public:
+            explicit FileLock(const std::string &path) {
+                fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+                if (fd >= 0) {
+                    ::flock(fd, LOCK_EX);
+                }
+            }
+
+            ~FileLock() {
+                if (fd >= 0) {
+                    ::flock(fd, LOCK_UN);
+                    ::close(fd);
+                }
+            }
+
+        private:
+            int fd = -1;
+        };
+
+        std::int64_t fileSize(const std::string &path) {
+            const auto state = statFile(path);
+
+            return state ? static_cast<std::int64_t>(state->size) : 0;
+        }
+
+        std::string temporaryName(const std::string &path) {
+            return path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        }
+    }
+
+
+    ObjectCache::ObjectCache(const std::string &directory, const std::uint64_t maxSize, const bool useHardLinks) {
+        this->directory = directory;
+        this->maxSize = maxSize;
+        this->useHardLinks = useHardLinks;
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+
+
+    bool ObjectCache::restore(const CompileOutput &output) {
+        const auto manifestKey = this->computeManifestKey(output);
+
+        if (! manifestKey) {
+            return false;
+        }
+
+        const std::string manifestFile = this->manifestPath(*manifestKey);
+        const std::vector<ManifestEntry> entries = this->readManifest(manifestFile);
+
+        for (auto entry = entries.rbegin(); entry != entries.rend(); entry++) {
+            const bool matches = std::all_of(entry->dependencies.begin(), entry->dependencies.end(), [] (const auto &dependency) {
+                return hashFile(dependency.first) == dependency.second;
+            });
+
+            if (! matches) {
+                continue;
+            }
+
+            const std::string object = this->objectPath(entry->objectKey);
+
+            if (! this->placeFile(object, output.objectFile, useHardLinks)) {
+                // evicted meanwhile
+                return false;
+            }
+
+            if (! output.dependencyFile.empty() && ! this->placeFile(object + ".d", output.dependencyFile, false)) {
+                return false;
+            }
+
+            // recently used objects (and manifests) are the last ones to be evicted
+            ::utimensat(AT_FDCWD, object.c_str(), nullptr, 0);
+            ::utimensat(AT_FDCWD, manifestFile.c_str(), nullptr, 0);
+
+            return true;
+        }
+
+        return false;
+    }
+
+
+    void ObjectCache::store(const CompileOutput &output) {
+        const auto manifestKey = this->computeManifestKey(output);
+
+        if (! manifestKey) {
+            return;
+        }
+
+        ManifestEntry entry;
+        std::string keyMaterial = toHex(*manifestKey);
+
+        const auto sourcePath = std::filesystem::path(output.sourceFile).lexically_normal();
+
+        std::vector<std::string> dependencies = loadDepFile(output.dependencyFile);
+        dependencies.insert(dependencies.end(), output.implicitDependencies.begin(), output.implicitDependencies.end());
+
+        for (const std::string &dependency : dependencies) {
+            if (std::filesystem::path(dependency).lexically_normal() == sourcePath) {
+                continue;
+            }
+
+            const auto dependencyHash = hashFile(dependency);
+
+            if (! dependencyHash) {
+                return;
+            }
+
+            entry.dependencies.push_back({dependency, *dependencyHash});
+            keyMaterial += "\n" + dependency + ":" + toHex(*dependencyHash);
+        }
+
+        entry.objectKey = hashString(keyMaterial);
+
+        const std::string object = this->objectPath(entry.objectKey);
+        std::int64_t addedSize = 0;
+
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(object).parent_path(), error);
+
+        if (! std::filesystem::exists(object)) {
+            const std::string temporaryObject = temporaryName(object);
+            const std::string temporaryDependencies = temporaryName(object + ".d");
+
+            if (! this->placeFile(output.objectFile, temporaryObject, false)) {
+                return;
+            }
+
+            if (! output.dependencyFile.empty()) {
+                this->placeFile(output.dependencyFile, temporaryDependencies, false);
+                std::rename(temporaryDependencies.c_str(), (object + ".d").c_str());
+            }
+
+            std::rename(temporaryObject.c_str(), object.c_str());
+
+            addedSize = fileSize(object) + fileSize(object + ".d");
+        }
+
+        const std::string manifestFile = this->manifestPath(*manifestKey);
+        std::filesystem::create_directories(std::filesystem::path(manifestFile).parent_path(), error);
+
+        {
+            FileLock lock {directory + "/lock"};
+
+            std::vector<ManifestEntry> entries = this->readManifest(manifestFile);
+
+            const bool known = std::any_of(entries.begin(), entries.end(), [&entry] (const ManifestEntry &other) {
+                return other.objectKey == entry.objectKey;
+            });
+
+            if (! known) {
+                entries.push_back(entry);
+
+                if (entries.size() > MAX_MANIFEST_ENTRIES) {
+                    entries.erase(entries.begin(), entries.end() - MAX_MANIFEST_ENTRIES);
+                }
+
+                // manifests take up room in the store too
+                const std::int64_t previousSize = fileSize(manifestFile);
+                this->writeManifest(manifestFile, entries);
+                addedSize += fileSize(manifestFile) - previousSize;
+            }
+
+            if (addedSize != 0) {
+                this->addToSize(addedSize);
+            }
+        }
+    }
+
+
+    std::optional<std::uint64_t> ObjectCache::computeManifestKey(const CompileOutput &output) {
+        const auto sourceHash = hashFile(output.sourceFile);
+
+        if (! sourceHash) {
+            return {};
+        }
+
+        const Command &command = output.command;
+
+        std::string keyMaterial = KEY_VERSION;
+        keyMaterial += "\n" + toHex(this->getCompilerIdentity(command.getPath() + command.getName()));
+        keyMaterial += "\n" + toHex(*sourceHash);
+
+        bool debugInfo = false;
+
+        for (const std::string &arg : command.getArgs()) {
+            // output locations don't change the object contents
+            if (arg.rfind("-o", 0) == 0 || arg.rfind("-MF", 0) == 0) {
+                continue;
+            }
+
+            if (arg == "-gsplit-dwarf") {
+                // the object alone isn't the whole output
+                return {};
+            }
+
+            if (arg.rfind("-g", 0) == 0) {
+                debugInfo = true;
+            }
+
+            keyMaterial += "\n" + arg;
+        }
+
+        if (debugInfo) {
+            // the working directory ends up in the debug information
+            std::error_code error;
+            keyMaterial += "\n" + std::filesystem::current_path(error).string();
+        }
+
+        return hashString(keyMaterial);
+    }
+
+
+    std::uint64_t ObjectCache::getCompilerIdentity(const std::string &compiler) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (auto it = compilerIdentities.find(compiler); it != compilerIdentities.end()) {
+            return it->second;
+        }
+
+        std::string resolved = compiler;
+
+        if (compiler.find('/') == std::string::npos) {
+            const char *path = std::getenv("PATH");
+            std::stringstream ss {path ? path : ""};
+            std::string entry;
+
+            while (std::getline(ss, entry, ':')) {
+                const std::string candidate = (entry.empty() ? "." : entry) + "/" + compiler;
+
+                if (::access(candidate.c_str(), X_OK) == 0) {
+                    resolved = candidate;
+                    break;
+                }
+            }
+        }
+
+        // like ccache's default compiler check: name, size and modification time of the binary
+        std::error_code error;
+        const std::string canonical = std::filesystem::canonical(resolved, error).string();
+        const FileState state = statFile(canonical.empty() ? resolved : canonical).value_or(FileState{});
+
+        const std::uint64_t identity = hashString(canonical + ":" + std::to_string(state.size) + ":" + std::to_string(state.modifiedTime));
+        compilerIdentities[compiler] = identity;
+
+        return identity;
+    }
+
+
+    std::vector<ObjectCache::ManifestEntry> ObjectCache::readManifest(const std::string &manifestFile) const {
+        std::vector<ManifestEntry> entries;
+        std::ifstream is {manifestFile};
+        std::string line;
+
+        // one "<object key> <dependency count>" line per entry, followed by "<hash> <path>" lines
+        while (std::getline(is, line)) {
+            ManifestEntry entry;
+            std::size_t count = 0;
+
+            if (std::sscanf(line.c_str(), "%" SCNx64 " %zu", &entry.objectKey, &count) != 2) {
+                break;
+            }
+
+            for (std::size_t i = 0; i < count && std::getline(is, line); i++) {
+                const std::size_t pos = line.find(' ');
+
+                if (pos == std::string::npos) {
+                    return entries;
+                }
+
+                entry.dependencies.push_back({line.substr(pos + 1), std::strtoull(line.substr(0, pos).c_str(), nullptr, 16)});
+            }
+
+            if (entry.dependencies.size() == count) {
+                entries.push_back(entry);
+            }
+        }
+
+        return entries;
+    }
+
+
+    void ObjectCache::writeManifest(const std::string &manifestFile, const std::vector<ManifestEntry> &entries) const {
+        const std::string temporaryFile = temporaryName(manifestFile);
+
+        {
+            std::ofstream os {temporaryFile};
+
+            for (const ManifestEntry &entry : entries) {
+                os << toHex(entry.objectKey) << " " << entry.dependencies.size() << "\n";
+
+                for (const auto &dependency : entry.dependencies) {
+                    os << toHex(dependency.second) << " " << dependency.first << "\n";
+                }
+            }
+        }
+
+        std::rename(temporaryFile.c_str(), manifestFile.c_str());
+    }
+
+
+    std::string ObjectCache::manifestPath(const std::uint64_t key) const {
+        const std::string hex = toHex(key);
+
+        return directory + "/manifests/" + hex.substr(0, 2) + "/" + hex + ".manifest";
+    }
+
+
+    std::string ObjectCache::objectPath(const std::uint64_t key) const {
+        const std::string hex = toHex(key);
+
+        return directory + "/objects/" + hex.substr(0, 2) + "/" + hex + ".obj";
+    }
+
+
+    bool ObjectCache::placeFile(const std::string &from, const std::string &to, const bool allowHardLink) const {
+        const int input = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (input < 0) {
+            return false;
+        }
+
+        ::unlink(to.c_str());
+
+        if (allowHardLink && ::link(from.c_str(), to.c_str()) == 0) {
+            ::close(input);
+            return true;
+        }
+
+        const int output = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (output < 0) {
+            ::close(input);
+            return false;
+        }
+
+        bool copied = ::ioctl(output, FICLONE, input) == 0;
+
+        if (! copied) {
+            // no reflink support on this filesystem: plain copy
+            char buffer[65536];
+            ssize_t count;
+            copied = true;
+
+            while ((count = ::read(input, buffer, sizeof(buffer))) > 0) {
+                if (::write(output, buffer, static_cast<std::size_t>(count)) != count) {
+                    copied = false;
+                    break;
+                }
+            }
+
+            copied = copied && count == 0;
+        }
+
+        ::close(input);
+        ::close(output);
+
+        if (! copied) {
+            ::unlink(to.c_str());
+        }
+
+        return copied;
+    }
+
+
+    void ObjectCache::addToSize(const std::int64_t delta) {
+        // callers hold the store lock
+        const std::string sizeFile = directory + "/size";
+        std::int64_t currentSize = 0;
+
+        {
+            std::ifstream is {sizeFile};
+            is >> currentSize;
+        }
+
+        currentSize = std::max<std::int64_t>(0, currentSize + delta);
+
+        if (static_cast<std::uint64_t>(currentSize) > maxSize) {
+            this->evict();
+            return;
+        }
+
+        std::ofstream os {sizeFile};
+        os << currentSize;
+    }
+
+
+    void ObjectCache::evict() {
+        // the least recently used first, whether objects (along with their depfiles) or manifests
+        std::vector<std::tuple<std::int64_t, std::uint64_t, std::string>> files;
+        std::uint64_t totalSize = 0;
+
+        for (const char *subdirectory : {"/objects", "/manifests"}) {
+            std::error_code error;
+
+            for (auto it = std::filesystem::recursive_directory_iterator(directory + subdirectory, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+                if (error) {
+                    break;
+                }
+
+                const std::string extension = it->path().extension().string();
+
+                if (extension != ".obj" && extension != ".manifest") {
+                    continue;
+                }
+
+                if (const auto state = statFile(it->path().string())) {
+                    const std::uint64_t size = state->size + (extension == ".obj" ? static_cast<std::uint64_t>(fileSize(it->path().string() + ".d")) : 0);
+
+                    files.push_back({state->modifiedTime, size, it->path().string()});
+                    totalSize += size;
+                }
+            }
+        }
+
+        std::sort(files.begin(), files.end());
+
+        // leave some headroom, so eviction doesn't run again on the next store
+        const std::uint64_t targetSize = maxSize / 10 * 9;
+
+        for (const auto &file : files) {
+            if (totalSize <= targetSize) {
+                break;
+            }
+
+            ::unlink(std::get<2>(file).c_str());
+            ::unlink((std::get<2>(file) + ".d").c_str());
+
+            totalSize -= std::get<1>(file);
+        }
+
+        std::ofstream os {directory + "/size"};
+        os << totalSize;
+    }
+}
@@ -12,7 +12,7 @@ namespace bok {
 
 
     Component* Package::addComponent(const std::string &name, const std::string &path, const std::vector<std::string> &sources) {
-        Component *component = new Component(this, name, path, sources);
+        Component *component = &storage.emplace_back(this, name, path, sources);
 
         components.push_back(component);
 
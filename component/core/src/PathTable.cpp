@@ -0,0 +1,56 @@
+
+#include <bok/core/PathTable.hpp>
+
+#include <cstring>
+
+
+namespace bok {
+    PathId PathTable::intern(std::string_view path) {
+        if (const auto it = ids.find(path); it != ids.end()) {
+            return it->second;
+        }
+
+        const std::string_view stored = this->store(path);
+        const auto id = static_cast<PathId>(paths.size());
+
+        paths.push_back(stored);
+        ids.emplace(stored, id);
+
+        return id;
+    }
+
+
+    const PathId* PathTable::find(std::string_view path) const {
+        const auto it = ids.find(path);
+
+        return it == ids.end() ? nullptr : &it->second;
+    }
+
+
+    std::string_view PathTable::store(std::string_view path) {
+        if (path.empty()) {
+            // nothing to copy, and there may be no block to point into yet
+            return {};
+        }
+
+        char *data = nullptr;
+
+        if (path.size() > BLOCK_SIZE / 4) {
+            // an allocation of its own, so the current block isn't wasted
+            largePaths.push_back(std::make_unique<char[]>(path.size()));
+            data = largePaths.back().get();
+        } else {
+            if (BLOCK_SIZE - blockUsed < path.size()) {
+                blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+                blockUsed = 0;
+            }
+
+            data = blocks.back().get() + blockUsed;
+            blockUsed += path.size();
+        }
+
+        std::memcpy(data, path.data(), path.size());
+
+        return {data, path.size()};
+    }
+}
@@ -0,0 +1,79 @@
+
+#include <bok/core/PrefixHeader.hpp>
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <sstream>
+#include <bok/core/FileState.hpp>
+#include <bok/core/IncludeScanner.hpp>
+
+
+namespace bok {
+    namespace {
+        /**
+         * Collects the system headers reached from 'file', following its local ('#include "..."') headers.
+         */
+        void collectSystemHeaders(IncludeScanner &scanner, const std::filesystem::path &file, std::set<std::filesystem::path> &visited, std::vector<std::string> &headers) {
+            if (! visited.insert(file).second) {
+                return;
+            }
+
+            const auto includes = scanner.getIncludes(file.string());
+
+            if (! includes) {
+                return;
+            }
+
+            for (const IncludeDirective &include : *includes) {
+                if (include.system) {
+                    headers.push_back(include.header);
+                } else if (const auto local = (file.parent_path() / include.header).lexically_normal(); std::filesystem::exists(local)) {
+                    collectSystemHeaders(scanner, local, visited, headers);
+                }
+            }
+        }
+    }
+
+
+    std::vector<std::string> findCommonSystemHeaders(IncludeScanner &scanner, const std::vector<std::string> &sources, const double minimumShare) {
+        std::map<std::string, std::size_t> counts;
+        std::vector<std::string> order;
+
+        for (const std::string &source : sources) {
+            std::set<std::filesystem::path> visited;
+            std::vector<std::string> headers;
+            std::set<std::string> included;
+
+            collectSystemHeaders(scanner, source, visited, headers);
+
+            for (const std::string &header : headers) {
+                if (included.insert(header).second && counts[header]++ == 0) {
+                    order.push_back(header);
+                }
+            }
+        }
+
+        std::vector<std::string> headers;
+
+        for (const std::string &header : order) {
+            if (counts[header] >= 2 && counts[header] >= minimumShare * sources.size()) {
+                headers.push_back(header);
+            }
+        }
+
+        return headers;
+    }
+
+
+    void writePrefixHeader(const std::string &path, const std::vector<std::string> &headers) {
+        std::stringstream ss;
+        ss << "\n// generated by bok: system headers shared by most sources of the component\n\n";
+
+        for (const std::string &header : headers) {
+            ss << "#include <" << header << ">\n";
+        }
+
+        writeFileIfChanged(path, ss.str());
+    }
+}
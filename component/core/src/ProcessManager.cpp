@@ -0,0 +1,352 @@
+
+#include <bok/core/ProcessManager.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+
+namespace bok {
+    namespace {
+        int openPidFd(const pid_t pid) {
+#ifdef SYS_pidfd_open
+            return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+            return -1;
+#endif
+        }
+
+        // how often children without a pidfd (pre-5.3 kernels) get polled
+        constexpr int FALLBACK_POLL_MS = 10;
+
+        std::string quoteResponseArg(const std::string &arg) {
+            std::string quoted;
+
+            for (const char ch : arg) {
+                if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\'' || ch == '"' || ch == '\\') {
+                    quoted += '\\';
+                }
+
+                quoted += ch;
+            }
+
+            return quoted;
+        }
+    }
+
+
+    struct ProcessManager::Process {
+        pid_t pid = -1;
+        int pidFd = -1;
+        int outputFd = -1;
+        int errorFd = -1;
+        bool exited = false;
+        std::chrono::steady_clock::time_point startTime;
+        std::string responseFile;
+        ProcessResult result;
+        std::promise<ProcessResult> promise;
+    };
+
+
+    ProcessManager::ProcessManager() {
+        epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = wakeFd;
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+        eventThread = std::thread{&ProcessManager::eventLoop, this};
+    }
+
+
+    ProcessManager::~ProcessManager() {
+        stopping = true;
+
+        const std::uint64_t value = 1;
+        ::write(wakeFd, &value, sizeof(value));
+
+        eventThread.join();
+
+        ::close(wakeFd);
+        ::close(epollFd);
+    }
+
+
+    ProcessManager& ProcessManager::getDefault() {
+        static ProcessManager processManager;
+
+        return processManager;
+    }
+
+
+    std::future<ProcessResult> ProcessManager::spawn(const Command &command) {
+        auto process = std::make_unique<Process>();
+        std::future<ProcessResult> future = process->promise.get_future();
+
+        const std::string program = command.getPath() + command.getName();
+        std::vector<std::string> args = command.getArgs();
+
+        std::size_t length = program.size();
+
+        for (const std::string &arg : args) {
+            length += arg.size() + 1;
+        }
+
+        if (command.isResponseFileAllowed() && length > RESPONSE_FILE_THRESHOLD) {
+            process->responseFile = (std::filesystem::temp_directory_path() / ("bok-" + std::to_string(::getpid()) + "-" + std::to_string(responseFileCount++) + ".rsp")).string();
+
+            std::ofstream os {process->responseFile};
+
+            for (const std::string &arg : args) {
+                os << quoteResponseArg(arg) << "\n";
+            }
+
+            args = {"@" + process->responseFile};
+        }
+
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(program.c_str()));
+
+        for (std::string &arg : args) {
+            argv.push_back(arg.data());
+        }
+
+        argv.push_back(nullptr);
+
+        int outputPipe[2], errorPipe[2];
+
+        if (::pipe2(outputPipe, O_CLOEXEC) != 0) {
+            throw std::runtime_error("Couldn't create a pipe: " + std::string{std::strerror(errno)});
+        }
+
+        if (::pipe2(errorPipe, O_CLOEXEC) != 0) {
+            ::close(outputPipe[0]);
+            ::close(outputPipe[1]);
+            throw std::runtime_error("Couldn't create a pipe: " + std::string{std::strerror(errno)});
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, outputPipe[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, errorPipe[1], STDERR_FILENO);
+
+        posix_spawnattr_t attributes;
+        posix_spawnattr_init(&attributes);
+#ifdef POSIX_SPAWN_USEVFORK
+        posix_spawnattr_setflags(&attributes, POSIX_SPAWN_USEVFORK);
+#endif
+
+        process->startTime = std::chrono::steady_clock::now();
+
+        const int error = ::posix_spawnp(&process->pid, program.c_str(), &actions, &attributes, argv.data(), environ);
+
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attributes);
+
+        ::close(outputPipe[1]);
+        ::close(errorPipe[1]);
+
+        if (error != 0) {
+            ::close(outputPipe[0]);
+            ::close(errorPipe[0]);
+
+            if (! process->responseFile.empty()) {
+                std::remove(process->responseFile.c_str());
+            }
+
+            // same convention as the shell
+            process->result.exitCode = 127;
+            process->result.standardError = program + ": " + std::strerror(error) + "\n";
+            process->promise.set_value(process->result);
+
+            return future;
+        }
+
+        // the event loop must never block on a read
+        ::fcntl(outputPipe[0], F_SETFL, O_NONBLOCK);
+        ::fcntl(errorPipe[0], F_SETFL, O_NONBLOCK);
+
+        process->pidFd = openPidFd(process->pid);
+        process->outputFd = outputPipe[0];
+        process->errorFd = errorPipe[0];
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            incoming.push_back(std::move(process));
+        }
+
+        const std::uint64_t value = 1;
+        ::write(wakeFd, &value, sizeof(value));
+
+        return future;
+    }
+
+
+    void ProcessManager::eventLoop() {
+        epoll_event events[64];
+
+        while (! stopping || ! processes.empty()) {
+            bool polling = false;
+
+            for (const auto &pair : processes) {
+                polling = polling || (pair.first->pidFd < 0 && !pair.first->exited);
+            }
+
+            const int count = ::epoll_wait(epollFd, events, 64, polling ? FALLBACK_POLL_MS : -1);
+
+            for (int i = 0; i < count; i++) {
+                const int fd = events[i].data.fd;
+
+                if (fd == wakeFd) {
+                    std::uint64_t value;
+                    ::read(wakeFd, &value, sizeof(value));
+
+                    std::vector<std::unique_ptr<Process>> newProcesses;
+
+                    {
+                        std::lock_guard<std::mutex> lock{mutex};
+                        newProcesses.swap(incoming);
+                    }
+
+                    for (auto &process : newProcesses) {
+                        this->registerProcess(std::move(process));
+                    }
+
+                    continue;
+                }
+
+                auto it = fdOwners.find(fd);
+
+                if (it == fdOwners.end()) {
+                    continue;
+                }
+
+                Process &process = *it->second;
+
+                if (fd == process.pidFd) {
+                    this->reapProcess(process);
+                } else {
+                    this->readOutput(process, fd);
+                }
+
+                this->finishIfDone(process);
+            }
+
+            if (polling) {
+                std::vector<Process*> pending;
+
+                for (const auto &pair : processes) {
+                    if (pair.first->pidFd < 0 && !pair.first->exited) {
+                        pending.push_back(pair.first);
+                    }
+                }
+
+                for (Process *process : pending) {
+                    this->reapProcess(*process);
+                    this->finishIfDone(*process);
+                }
+            }
+        }
+    }
+
+
+    void ProcessManager::registerProcess(std::unique_ptr<Process> process) {
+        Process *raw = process.get();
+        processes[raw] = std::move(process);
+
+        for (const int fd : {raw->pidFd, raw->outputFd, raw->errorFd}) {
+            if (fd < 0) {
+                continue;
+            }
+
+            epoll_event event {};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+
+            ::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+            fdOwners[fd] = raw;
+        }
+    }
+
+
+    void ProcessManager::readOutput(Process &process, const int fd) {
+        char buffer[16384];
+        const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+
+        if (count > 0) {
+            std::string &output = (fd == process.outputFd) ? process.result.standardOutput : process.result.standardError;
+            output.append(buffer, static_cast<std::size_t>(count));
+
+            return;
+        }
+
+        if (count < 0 && (errno == EINTR || errno == EAGAIN)) {
+            return;
+        }
+
+        // end of stream
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        fdOwners.erase(fd);
+
+        if (fd == process.outputFd) {
+            process.outputFd = -1;
+        } else {
+            process.errorFd = -1;
+        }
+    }
+
+
+    void ProcessManager::reapProcess(Process &process) {
+        int status = 0;
+
+        const pid_t pid = ::wait4(process.pid, &status, WNOHANG, &process.result.usage);
+
+        if (pid != process.pid) {
+            return;
+        }
+
+        process.exited = true;
+        process.result.duration = std::chrono::steady_clock::now() - process.startTime;
+
+        if (WIFEXITED(status)) {
+            process.result.exitCode = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            process.result.exitCode = 128 + WTERMSIG(status);
+        }
+
+        if (process.pidFd >= 0) {
+            ::epoll_ctl(epollFd, EPOLL_CTL_DEL, process.pidFd, nullptr);
+            ::close(process.pidFd);
+            fdOwners.erase(process.pidFd);
+            process.pidFd = -1;
+        }
+    }
+
+
+    void ProcessManager::finishIfDone(Process &process) {
+        if (! process.exited || process.outputFd >= 0 || process.errorFd >= 0) {
+            return;
+        }
+
+        if (! process.responseFile.empty()) {
+            std::remove(process.responseFile.c_str());
+        }
+
+        process.promise.set_value(std::move(process.result));
+        processes.erase(&process);
+    }
+}
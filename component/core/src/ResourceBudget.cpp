@@ -0,0 +1,257 @@
+
+#include <bok/core/ResourceBudget.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+
+namespace bok {
+    namespace {
+        constexpr auto SAMPLE_INTERVAL = std::chrono::milliseconds(250);
+
+        // cgroup v1 reports "no limit" as a huge number, rounded down to the page size
+        constexpr std::uint64_t UNLIMITED_MEMORY = 1ull << 60;
+
+        std::optional<std::uint64_t> readNumber(const std::string &file) {
+            std::ifstream is {file};
+            std::string value;
+
+            if (! (is >> value) || value == "max") {
+                return {};
+            }
+
+            try {
+                return std::stoull(value);
+            } catch (const std::exception &) {
+                return {};
+            }
+        }
+
+
+        /**
+         * The value of 'key' in /proc/meminfo, in bytes.
+         */
+        std::optional<std::uint64_t> readMemoryInfo(const std::string &key) {
+            std::ifstream is {"/proc/meminfo"};
+            std::string line;
+
+            while (std::getline(is, line)) {
+                if (line.compare(0, key.size(), key) != 0 || line.size() <= key.size() || line[key.size()] != ':') {
+                    continue;
+                }
+
+                std::istringstream ss {line.substr(key.size() + 1)};
+                std::uint64_t kilobytes = 0;
+
+                if (ss >> kilobytes) {
+                    return kilobytes * 1024;
+                }
+            }
+
+            return {};
+        }
+
+
+        /**
+         * The cgroup v2 directory of this process, if any.
+         */
+        std::optional<std::string> findCgroupDirectory() {
+            std::ifstream is {"/proc/self/cgroup"};
+            std::string line;
+
+            while (std::getline(is, line)) {
+                if (line.compare(0, 3, "0::") == 0) {
+                    return "/sys/fs/cgroup" + line.substr(3);
+                }
+            }
+
+            return {};
+        }
+
+
+        /**
+         * The cgroup v1 memory controller directory of this process, if any.
+         */
+        std::optional<std::string> findCgroupV1MemoryDirectory() {
+            std::ifstream is {"/proc/self/cgroup"};
+            std::string line;
+
+            while (std::getline(is, line)) {
+                // like "4:memory:/user.slice"
+                const std::size_t first = line.find(':');
+                const std::size_t second = line.find(':', first + 1);
+
+                if (first == std::string::npos || second == std::string::npos) {
+                    continue;
+                }
+
+                std::stringstream controllers {line.substr(first + 1, second - first - 1)};
+                std::string controller;
+
+                while (std::getline(controllers, controller, ',')) {
+                    if (controller == "memory") {
+                        return "/sys/fs/cgroup/memory" + line.substr(second + 1);
+                    }
+                }
+            }
+
+            return {};
+        }
+    }
+
+
+    ResourceBudget::ResourceBudget(const std::uint64_t memoryLimit, const std::size_t linkJobLimit) {
+        this->linkJobLimit = linkJobLimit;
+        this->hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+        if (memoryLimit > 0) {
+            this->memoryLimit = memoryLimit;
+        } else {
+            const std::optional<std::uint64_t> totalMemory = readTotalMemory();
+            const std::optional<std::uint64_t> cgroupLimit = readCgroupMemoryLimit();
+
+            this->memoryLimit = std::min(totalMemory.value_or(UNLIMITED_MEMORY), cgroupLimit.value_or(UNLIMITED_MEMORY));
+        }
+    }
+
+
+    std::size_t ResourceBudget::getLinkJobLimit(const std::size_t jobLimit) const {
+        if (linkJobLimit > 0) {
+            return linkJobLimit;
+        }
+
+        return std::max<std::size_t>(1, jobLimit / 4);
+    }
+
+
+    bool ResourceBudget::tryReserve(const bool link, const std::uint64_t memory, const std::size_t running, const std::size_t jobLimit) {
+        if (running > 0) {
+            if (link && runningLinks >= this->getLinkJobLimit(jobLimit)) {
+                return false;
+            }
+
+            if (std::chrono::steady_clock::now() - lastSample >= SAMPLE_INTERVAL) {
+                this->sample(running);
+            }
+
+            if (running + std::min(loadExcess, jobLimit - 1) >= jobLimit) {
+                return false;
+            }
+
+            if (reservedMemory + memory > memoryLimit) {
+                return false;
+            }
+
+            // what was reserved since the last sample is likely not in use yet
+            if (availableMemory && reservedSinceSample + memory > *availableMemory) {
+                return false;
+            }
+        }
+
+        reservedMemory += memory;
+        reservedSinceSample += memory;
+        peakReservedMemory = std::max(peakReservedMemory, reservedMemory);
+
+        if (link) {
+            runningLinks++;
+        }
+
+        return true;
+    }
+
+
+    void ResourceBudget::release(const bool link, const std::uint64_t memory) {
+        reservedMemory -= std::min(reservedMemory, memory);
+
+        if (link && runningLinks > 0) {
+            runningLinks--;
+        }
+    }
+
+
+    void ResourceBudget::sample(const std::size_t running) {
+        lastSample = std::chrono::steady_clock::now();
+        availableMemory = readAvailableMemory();
+        reservedSinceSample = 0;
+        loadExcess = 0;
+
+        // the actions running are part of the load too: only back off from the load they don't explain
+        if (const std::optional<double> load = readLoadAverage(); load && *load > static_cast<double>(hardwareThreads)) {
+            const double overload = *load - static_cast<double>(hardwareThreads);
+            const double foreignLoad = std::max(0.0, *load - static_cast<double>(running));
+
+            loadExcess = static_cast<std::size_t>(std::min(overload, foreignLoad));
+        }
+    }
+
+
+    std::optional<std::uint64_t> ResourceBudget::readCgroupMemoryLimit() {
+        if (const std::optional<std::string> directory = findCgroupDirectory()) {
+            // the limits of the parent groups apply too
+            std::optional<std::uint64_t> limit;
+            std::string current = *directory;
+
+            while (current.size() >= std::string{"/sys/fs/cgroup"}.size()) {
+                if (const std::optional<std::uint64_t> value = readNumber(current + "/memory.max")) {
+                    limit = std::min(limit.value_or(UNLIMITED_MEMORY), *value);
+                }
+
+                const std::size_t slash = current.rfind('/');
+
+                if (slash == std::string::npos || slash == 0) {
+                    break;
+                }
+
+                current.erase(slash);
+            }
+
+            if (limit) {
+                return limit;
+            }
+        }
+
+        if (const std::optional<std::string> directory = findCgroupV1MemoryDirectory()) {
+            if (const std::optional<std::uint64_t> value = readNumber(*directory + "/memory.limit_in_bytes"); value && *value < UNLIMITED_MEMORY) {
+                return value;
+            }
+        }
+
+        return {};
+    }
+
+
+    std::optional<std::uint64_t> ResourceBudget::readAvailableMemory() {
+        std::optional<std::uint64_t> available = readMemoryInfo("MemAvailable");
+
+        if (const std::optional<std::string> directory = findCgroupDirectory()) {
+            const std::optional<std::uint64_t> limit = readNumber(*directory + "/memory.max");
+            const std::optional<std::uint64_t> current = readNumber(*directory + "/memory.current");
+
+            if (limit && current) {
+                const std::uint64_t cgroupAvailable = *limit > *current ? *limit - *current : 0;
+                available = std::min(available.value_or(cgroupAvailable), cgroupAvailable);
+            }
+        }
+
+        return available;
+    }
+
+
+    std::optional<std::uint64_t> ResourceBudget::readTotalMemory() {
+        return readMemoryInfo("MemTotal");
+    }
+
+
+    std::optional<double> ResourceBudget::readLoadAverage() {
+        std::ifstream is {"/proc/loadavg"};
+        double load = 0.0;
+
+        if (is >> load) {
+            return load;
+        }
+
+        return {};
+    }
+}
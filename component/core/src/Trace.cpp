@@ -0,0 +1,214 @@
+
+#include <bok/core/Trace.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <unistd.h>
+
+
+namespace bok {
+    namespace {
+        thread_local Trace::Scope *currentScope = nullptr;
+        thread_local int lane = -1;
+        std::atomic<int> nextLane = 0;
+
+        std::string escape(const std::string &value) {
+            std::string escaped;
+
+            for (const char ch : value) {
+                switch (ch) {
+                    case '"': escaped += "\\\""; break;
+                    case '\\': escaped += "\\\\"; break;
+                    case '\n': escaped += "\\n"; break;
+                    case '\t': escaped += "\\t"; break;
+                    default:
+                        if (static_cast<unsigned char>(ch) < 0x20) {
+                            char buffer[8];
+                            std::snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+                            escaped += buffer;
+                        } else {
+                            escaped += ch;
+                        }
+                }
+            }
+
+            return escaped;
+        }
+    }
+
+
+    Trace::Scope::Scope(Trace &trace, const std::string &name, const std::string &category) 
+        : trace(trace) {
+
+        enabled = trace.isEnabled();
+
+        if (! enabled) {
+            return;
+        }
+
+        this->name = name;
+        this->category = category;
+        this->start = std::chrono::steady_clock::now();
+        this->parent = currentScope;
+
+        currentScope = this;
+    }
+
+
+    Trace::Scope::~Scope() {
+        if (! enabled) {
+            return;
+        }
+
+        currentScope = parent;
+
+        const auto end = std::chrono::steady_clock::now();
+
+        trace.addEvent({
+            name, 
+            category, 
+            trace.toMicroseconds(start), 
+            std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(), 
+            Trace::currentLane(), 
+            std::move(args)
+        });
+    }
+
+
+    void Trace::Scope::setArg(const std::string &key, const std::string &value) {
+        if (enabled) {
+            args[key] = "\"" + escape(value) + "\"";
+        }
+    }
+
+
+    void Trace::Scope::setArg(const std::string &key, const std::int64_t value) {
+        if (enabled) {
+            args[key] = std::to_string(value);
+        }
+    }
+
+
+    Trace::Trace() {
+        origin = std::chrono::steady_clock::now();
+    }
+
+
+    void Trace::annotate(const std::string &key, const std::int64_t value) {
+        if (currentScope) {
+            currentScope->setArg(key, value);
+        }
+    }
+
+
+    void Trace::count(const std::string &metric, const std::int64_t delta) {
+        std::lock_guard<std::mutex> lock{mutex};
+        metrics[metric] += static_cast<double>(delta);
+    }
+
+
+    void Trace::setMetric(const std::string &metric, const double value) {
+        std::lock_guard<std::mutex> lock{mutex};
+        metrics[metric] = value;
+    }
+
+
+    std::map<std::string, double> Trace::getMetrics() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return metrics;
+    }
+
+
+    bool Trace::writeChromeTrace(const std::string &path) const {
+        std::ofstream os {path};
+
+        if (! os.is_open()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        const int pid = static_cast<int>(::getpid());
+        std::set<int> lanes;
+
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        for (const Event &event : events) {
+            os << "{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << escape(event.category) << "\",\"ph\":\"X\""
+               << ",\"ts\":" << event.start << ",\"dur\":" << event.duration 
+               << ",\"pid\":" << pid << ",\"tid\":" << event.lane << ",\"args\":{";
+
+            const char *separator = "";
+
+            for (const auto &arg : event.args) {
+                os << separator << "\"" << escape(arg.first) << "\":" << arg.second;
+                separator = ",";
+            }
+
+            os << "}},\n";
+
+            lanes.insert(event.lane);
+        }
+
+        for (const int lane : lanes) {
+            os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << lane 
+               << ",\"args\":{\"name\":\"" << (lane == 0 ? std::string{"main"} : "lane " + std::to_string(lane)) << "\"}},\n";
+        }
+
+        os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"bok\"}}\n]}\n";
+
+        return os.good();
+    }
+
+
+    bool Trace::writeMetrics(const std::string &path) const {
+        std::ofstream os {path};
+
+        if (! os.is_open()) {
+            return false;
+        }
+
+        const auto values = this->getMetrics();
+        const char *separator = "";
+
+        os << "{";
+
+        for (const auto &pair : values) {
+            os << separator << "\n  \"" << escape(pair.first) << "\": " << pair.second;
+            separator = ",";
+        }
+
+        os << "\n}\n";
+
+        return os.good();
+    }
+
+
+    Trace& Trace::getDefault() {
+        static Trace trace;
+
+        return trace;
+    }
+
+
+    void Trace::addEvent(Event event) {
+        std::lock_guard<std::mutex> lock{mutex};
+        events.push_back(std::move(event));
+    }
+
+
+    std::int64_t Trace::toMicroseconds(const std::chrono::steady_clock::time_point time) const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time - origin).count();
+    }
+
+
+    int Trace::currentLane() {
+        if (lane < 0) {
+            lane = nextLane++;
+        }
+
+        return lane;
+    }
+}
@@ -0,0 +1,79 @@
+
+#include <bok/core/UnityBuild.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <bok/core/Hash.hpp>
+
+
+namespace bok {
+    std::vector<UnityBatch> planUnityBatches(const std::vector<std::string> &sources, const std::size_t maxBatchSize, const std::size_t jobSlots, std::size_t &bucketCount) {
+        const std::size_t batchSize = std::max<std::size_t>(maxBatchSize, 1);
+
+        // hysteresis: growing or shrinking by a few sources mustn't reshuffle every batch
+        const bool overfilled = bucketCount == 0 || sources.size() > bucketCount * batchSize;
+        const bool underfilled = bucketCount > 1 && sources.size() * 4 < bucketCount * batchSize;
+
+        if (overfilled || underfilled) {
+            bucketCount = 1;
+
+            while (bucketCount * batchSize < sources.size() * 2) {
+                bucketCount *= 2;
+            }
+        }
+
+        std::vector<std::vector<std::string>> buckets(bucketCount);
+
+        for (const std::string &source : sources) {
+            buckets[hashString(source) % bucketCount].push_back(source);
+        }
+
+        // fewer buckets than job slots would leave slots idle: each bucket is split further, by a number 
+        // that doesn't depend on the sources, so the split stays as stable as the buckets themselves
+        const std::size_t slotParts = (std::max<std::size_t>(jobSlots, 1) + bucketCount - 1) / bucketCount;
+
+        std::vector<UnityBatch> batches;
+
+        for (std::size_t i = 0; i < bucketCount; i++) {
+            std::vector<std::string> &bucket = buckets[i];
+
+            if (bucket.empty()) {
+                continue;
+            }
+
+            std::sort(bucket.begin(), bucket.end());
+
+            // but never into batches of a single source, which merge nothing
+            const std::size_t parts = std::max((bucket.size() + batchSize - 1) / batchSize, std::min(slotParts, std::max<std::size_t>(bucket.size() / 2, 1)));
+
+            if (parts == 1) {
+                batches.push_back({std::to_string(i), std::move(bucket)});
+                continue;
+            }
+
+            // evenly, so one more source doesn't leave a batch with a single one
+
+            for (std::size_t part = 0; part < parts; part++) {
+                const std::size_t begin = bucket.size() * part / parts;
+                const std::size_t end = bucket.size() * (part + 1) / parts;
+
+                batches.push_back({std::to_string(i) + "-" + std::to_string(part), {bucket.begin() + begin, bucket.begin() + end}});
+            }
+        }
+
+        return batches;
+    }
+
+
+    std::string makeUnitySource(const std::string &unityFile, const std::vector<std::string> &sources) {
+        const std::filesystem::path directory = std::filesystem::path(unityFile).parent_path();
+
+        std::string content = "\n// generated by bok: unity build batch\n\n";
+
+        for (const std::string &source : sources) {
+            content += "#include \"" + std::filesystem::path(source).lexically_relative(directory).generic_string() + "\"\n";
+        }
+
+        return content;
+    }
+}
@@ -0,0 +1,273 @@
+
+#include <bok/core/WorkerPool.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include <bok/core/CompileWorker.hpp>
+#include <bok/core/Compiler.hpp>
+#include <bok/core/Trace.hpp>
+
+
+namespace bok {
+    namespace {
+        // how long a worker that failed is left alone
+        constexpr std::chrono::seconds RETRY_DELAY {10};
+
+        constexpr std::chrono::milliseconds CONNECT_TIMEOUT {1000};
+
+
+        std::optional<std::string> readFile(const std::string &path) {
+            std::ifstream is {path, std::ios::binary};
+
+            if (! is) {
+                return {};
+            }
+
+            std::stringstream content;
+            content << is.rdbuf();
+
+            return content.str();
+        }
+
+
+        /**
+         * Sends a request of 'type', made of 'payload' (unless empty), and returns the response.
+         */
+        std::optional<std::string> sendRequest(const WorkerEndpoint &endpoint, const WorkerRequest type, const std::string &payload, const std::chrono::milliseconds timeout) {
+            const int fd = connectTo(endpoint, CONNECT_TIMEOUT);
+
+            if (fd < 0) {
+                return {};
+            }
+
+            setSocketTimeout(fd, timeout);
+
+            std::optional<std::string> response;
+            const bool sent = sendMessage(fd, WireWriter{}.put(static_cast<std::uint8_t>(type)).getData()) 
+                && (payload.empty() || sendMessage(fd, payload));
+
+            if (sent) {
+                response = receiveMessage(fd);
+            }
+
+            ::close(fd);
+
+            return response;
+        }
+    }
+
+
+    WorkerPool::WorkerPool(const std::vector<WorkerEndpoint> &endpoints, const Compiler *compiler) {
+        this->compiler = compiler;
+
+        for (const WorkerEndpoint &endpoint : endpoints) {
+            Worker worker;
+            worker.endpoint = endpoint;
+            workers.push_back(worker);
+        }
+    }
+
+
+    std::size_t WorkerPool::probe() {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::size_t total = 0;
+
+        for (Worker &worker : workers) {
+            const auto response = sendRequest(worker.endpoint, WorkerRequest::Status, "", CONNECT_TIMEOUT);
+            std::uint32_t load = 0;
+            std::uint32_t jobLimit = 0;
+
+            if (response) {
+                WireReader reader {*response};
+
+                if (! reader.get(load) || ! reader.get(jobLimit)) {
+                    jobLimit = 0;
+                }
+            }
+
+            if (! response || jobLimit == 0) {
+                worker.retryAfter = std::chrono::steady_clock::now() + RETRY_DELAY;
+                continue;
+            }
+
+            worker.reportedLoad = load;
+            worker.jobLimit = jobLimit;
+            total += jobLimit;
+        }
+
+        probed = true;
+
+        return total;
+    }
+
+
+    std::optional<ProcessResult> WorkerPool::compile(const CompileOutput &output) {
+        std::optional<RemoteCompile> remote = compiler->prepareRemoteCompile(output);
+
+        if (! remote) {
+            return {};
+        }
+
+        std::vector<std::string> command = remote->remoteCommand.getArgs();
+        command.insert(command.begin(), remote->remoteCommand.getName());
+
+        if (! CompileWorker::isAllowedCommand(command)) {
+            // like a flag the workers don't know: they would refuse it, so it stays local
+            Trace::getDefault().count("workers.refused");
+            return {};
+        }
+
+        std::call_once(probeOnce, [this] () {
+            if (! probed) {
+                this->probe();
+            }
+        });
+
+        Worker *worker = this->acquireWorker();
+
+        if (! worker) {
+            Trace::getDefault().count("workers.busy");
+            return {};
+        }
+
+        // preprocessing errors are compile errors, no worker would do better
+        ProcessResult preprocessing;
+
+        try {
+            preprocessing = remote->preprocessCommand.execute();
+        } catch (const CommandError &error) {
+            this->releaseWorker(worker, false);
+            std::remove(remote->preprocessedFile.c_str());
+
+            return error.getResult();
+        }
+
+        const std::optional<std::string> input = readFile(remote->preprocessedFile);
+        std::remove(remote->preprocessedFile.c_str());
+
+        if (! input) {
+            this->releaseWorker(worker, false);
+            return {};
+        }
+
+        auto result = this->compileOn(*worker, command, *input, output.objectFile);
+
+        if (! result) {
+            Trace::getDefault().count("workers.fallbacks");
+            return {};
+        }
+
+        // the warnings of the preprocessor come first, as they would locally
+        result->standardError = preprocessing.standardError + result->standardError;
+
+        return result;
+    }
+
+
+    std::optional<ProcessResult> WorkerPool::compileOn(Worker &worker, const std::vector<std::string> &command, const std::string &input, const std::string &objectFile) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto response = sendRequest(worker.endpoint, WorkerRequest::Compile, WireWriter{}.put(command).put(input).getData(), timeout);
+
+        ProcessResult result;
+        std::int32_t exitCode = 0;
+        std::string object;
+        std::uint32_t load = 0;
+        std::uint32_t jobLimit = 0;
+
+        if (! response) {
+            this->releaseWorker(&worker, true);
+            return {};
+        }
+
+        WireReader reader {*response};
+
+        if (! reader.get(exitCode) 
+            || ! reader.get(result.standardOutput) 
+            || ! reader.get(result.standardError) 
+            || ! reader.get(object) 
+            || ! reader.get(load) 
+            || ! reader.get(jobLimit)) {
+            this->releaseWorker(&worker, true);
+            return {};
+        }
+
+        this->releaseWorker(&worker, false, load);
+
+        result.exitCode = exitCode;
+        result.duration = std::chrono::steady_clock::now() - start;
+
+        if (result.succeeded()) {
+            // written aside and renamed, so an interrupted build never leaves half an object behind
+            const std::string temporaryFile = objectFile + ".tmp";
+
+            {
+                std::ofstream os {temporaryFile, std::ios::binary | std::ios::trunc};
+                os << object;
+            }
+
+            if (std::rename(temporaryFile.c_str(), objectFile.c_str()) != 0) {
+                std::remove(temporaryFile.c_str());
+                return {};
+            }
+        }
+
+        return result;
+    }
+
+
+    WorkerPool::Worker* WorkerPool::acquireWorker() {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        const auto now = std::chrono::steady_clock::now();
+        Worker *best = nullptr;
+        double bestLoad = 0.0;
+
+        for (Worker &worker : workers) {
+            if (worker.jobLimit == 0 || worker.retryAfter > now) {
+                continue;
+            }
+
+            // other builds may be using it too
+            const std::uint32_t busy = std::max(worker.inflight, worker.reportedLoad);
+
+            if (busy >= worker.jobLimit) {
+                continue;
+            }
+
+            const double load = static_cast<double>(busy) / worker.jobLimit;
+
+            if (! best || load < bestLoad) {
+                best = &worker;
+                bestLoad = load;
+            }
+        }
+
+        if (best) {
+            best->inflight++;
+            best->reportedLoad++;
+        }
+
+        return best;
+    }
+
+
+    void WorkerPool::releaseWorker(Worker *worker, const bool failed, const std::optional<std::uint32_t> load) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        worker->inflight--;
+
+        if (load) {
+            worker->reportedLoad = *load;
+        } else if (worker->reportedLoad > 0) {
+            worker->reportedLoad--;
+        }
+
+        if (failed) {
+            worker->retryAfter = std::chrono::steady_clock::now() + RETRY_DELAY;
+        }
+    }
+}
@@ -0,0 +1,283 @@
+
+#include <bok/core/WorkerProtocol.hpp>
+
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+namespace bok {
+    namespace {
+        // a preprocessed source, or an object, never comes close
+        constexpr std::uint32_t MAX_MESSAGE_SIZE = 1024 * 1024 * 1024;
+
+
+        bool makeAddress(const std::string &socketPath, sockaddr_un &address) {
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+
+            if (socketPath.size() >= sizeof(address.sun_path)) {
+                return false;
+            }
+
+            std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+            return true;
+        }
+
+
+        addrinfo* resolve(const WorkerEndpoint &endpoint, const bool passive) {
+            addrinfo hints {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+            addrinfo *addresses = nullptr;
+            const std::string port = std::to_string(endpoint.port);
+
+            if (::getaddrinfo(endpoint.host.empty() ? nullptr : endpoint.host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+                return nullptr;
+            }
+
+            return addresses;
+        }
+
+
+        bool sendAll(const int fd, const char *data, const std::size_t size) {
+            std::size_t offset = 0;
+
+            while (offset < size) {
+                // a peer that went away must not take the process down with a SIGPIPE
+                const ssize_t sent = ::send(fd, data + offset, size - offset, MSG_NOSIGNAL);
+
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+
+                if (sent <= 0) {
+                    return false;
+                }
+
+                offset += static_cast<std::size_t>(sent);
+            }
+
+            return true;
+        }
+
+
+        bool receiveAll(const int fd, char *data, const std::size_t size) {
+            std::size_t offset = 0;
+
+            while (offset < size) {
+                const ssize_t received = ::recv(fd, data + offset, size - offset, 0);
+
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+
+                if (received <= 0) {
+                    return false;
+                }
+
+                offset += static_cast<std::size_t>(received);
+            }
+
+            return true;
+        }
+    }
+
+
+    WorkerEndpoint WorkerEndpoint::parse(const std::string &value) {
+        WorkerEndpoint endpoint;
+
+        if (value.rfind("unix:", 0) == 0 && value.size() > 5) {
+            endpoint.kind = Kind::Unix;
+            endpoint.path = value.substr(5);
+
+            return endpoint;
+        }
+
+        const std::size_t colon = value.rfind(':');
+
+        if (value.rfind("tcp:", 0) == 0 && colon > 3) {
+            endpoint.kind = Kind::Tcp;
+            endpoint.host = value.substr(4, colon - 4);
+
+            try {
+                const int port = std::stoi(value.substr(colon + 1));
+
+                if (port > 0 && port < 65536) {
+                    endpoint.port = static_cast<std::uint16_t>(port);
+                    return endpoint;
+                }
+            } catch (const std::exception &) {}
+        }
+
+        throw std::runtime_error("Invalid worker endpoint '" + value + "', expected 'unix:<path>' or 'tcp:<host>:<port>'");
+    }
+
+
+    std::string WorkerEndpoint::toString() const {
+        if (kind == Kind::Unix) {
+            return "unix:" + path;
+        }
+
+        return "tcp:" + host + ":" + std::to_string(port);
+    }
+
+
+    int listenOn(const WorkerEndpoint &endpoint) {
+        int fd = -1;
+
+        if (endpoint.kind == WorkerEndpoint::Kind::Unix) {
+            sockaddr_un address;
+
+            if (! makeAddress(endpoint.path, address)) {
+                throw std::runtime_error("The socket path '" + endpoint.path + "' is too long");
+            }
+
+            // left behind by a worker that didn't exit cleanly
+            ::unlink(endpoint.path.c_str());
+
+            fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+            if (fd >= 0 && ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        } else {
+            addrinfo *addresses = resolve(endpoint, true);
+
+            for (addrinfo *address = addresses; address && fd < 0; address = address->ai_next) {
+                fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+
+                if (fd < 0) {
+                    continue;
+                }
+
+                const int reuse = 1;
+                ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+                if (::bind(fd, address->ai_addr, address->ai_addrlen) != 0) {
+                    ::close(fd);
+                    fd = -1;
+                }
+            }
+
+            if (addresses) {
+                ::freeaddrinfo(addresses);
+            }
+        }
+
+        if (fd < 0 || ::listen(fd, 64) != 0) {
+            const std::string error = std::strerror(errno);
+
+            if (fd >= 0) {
+                ::close(fd);
+            }
+
+            throw std::runtime_error("Couldn't listen on '" + endpoint.toString() + "': " + error);
+        }
+
+        return fd;
+    }
+
+
+    int connectTo(const WorkerEndpoint &endpoint, const std::chrono::milliseconds timeout) {
+        if (endpoint.kind == WorkerEndpoint::Kind::Unix) {
+            sockaddr_un address;
+
+            if (! makeAddress(endpoint.path, address)) {
+                return -1;
+            }
+
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+            if (fd >= 0 && ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+
+            return fd;
+        }
+
+        addrinfo *addresses = resolve(endpoint, false);
+        int fd = -1;
+
+        for (addrinfo *address = addresses; address && fd < 0; address = address->ai_next) {
+            fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, address->ai_protocol);
+
+            if (fd < 0) {
+                continue;
+            }
+
+            // a connect that doesn't complete within the timeout counts as a dead worker
+            if (::connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+                pollfd pending {fd, POLLOUT, 0};
+                int error = 0;
+                socklen_t errorSize = sizeof(error);
+
+                if (errno != EINPROGRESS 
+                    || ::poll(&pending, 1, static_cast<int>(timeout.count())) != 1 
+                    || ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorSize) != 0 
+                    || error != 0) {
+                    ::close(fd);
+                    fd = -1;
+                    continue;
+                }
+            }
+
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+            const int noDelay = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+
+        if (addresses) {
+            ::freeaddrinfo(addresses);
+        }
+
+        return fd;
+    }
+
+
+    void setSocketTimeout(const int fd, const std::chrono::milliseconds timeout) {
+        timeval value {};
+        value.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+        value.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &value, sizeof(value));
+    }
+
+
+    bool sendMessage(const int fd, const std::string &payload) {
+        const auto size = static_cast<std::uint32_t>(payload.size());
+
+        return sendAll(fd, reinterpret_cast<const char*>(&size), sizeof(size)) && sendAll(fd, payload.data(), payload.size());
+    }
+
+
+    std::optional<std::string> receiveMessage(const int fd) {
+        std::uint32_t size = 0;
+
+        if (! receiveAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) || size > MAX_MESSAGE_SIZE) {
+            return {};
+        }
+
+        std::string payload(size, '\0');
+
+        if (! receiveAll(fd, payload.data(), payload.size())) {
+            return {};
+        }
+
+        return payload;
+    }
+}
@@ -5,11 +5,16 @@
 
 #include "Dependency.hpp"
 
-namespace bok {
+namespace bok::input {
 	struct ComponentLanguage {
 		std::string name;
 		std::string dialect;
 
+		ComponentLanguage() = default;
+
+		/**
+		 * Parses a "<name>[/<dialect>]" language, like "c++/17".
+		 */
 		explicit ComponentLanguage(const std::string &value);
 
 		~ComponentLanguage();
@@ -19,6 +24,11 @@ namespace bok {
 		std::string name;
 		std::string kind;
 
+		ComponentType() = default;
+
+		/**
+		 * Parses a "<name>[/<kind>]" type, like "application/console".
+		 */
 		explicit ComponentType(const std::string &value);
 
 		~ComponentType();
@@ -27,6 +37,7 @@ namespace bok {
 	struct Component {
 		std::string name;
 		std::string description;
+		std::string path;		// the directory of its manifest, relative to the package
 		ComponentType type;
 		std::vector<ComponentLanguage> languages;
 		std::vector<std::string> sources;
@@ -7,7 +7,7 @@
 
 #include "Version.hpp"
 
-namespace bok {
+namespace bok::input {
 	struct DependencyVersion {
 		enum class Restriction {
 			GreaterOrEqual,
@@ -24,6 +24,11 @@ namespace bok {
 		Dependency() = default;
 		Dependency(const Dependency &other) = default;
 		
+		/**
+		 * Parses a "<package>[<restriction><version>][/<component> | /[<component>, ...]]" dependency, 
+		 * where the restriction is one of ">=", "==" or "<=". For example:
+		 * "boost>=1.70.0/[filesystem, system]" or "jbeder/yaml-cpp".
+		 */
 		explicit Dependency(const std::string &value);
 		
 		std::string packageName;
@@ -0,0 +1,62 @@
+
+#pragma once 
+
+#include <string>
+#include <vector>
+
+#include "Component.hpp"
+#include "Package.hpp"
+
+namespace bok {
+    class Package;
+}
+
+namespace bok::input {
+    /**
+     * A package manifest along with the manifests of all its components.
+     */
+    struct Manifest {
+        Package package;
+        std::vector<Component> components;
+    };
+
+
+    /**
+     * Loads the 'bok.yaml' of a package, and the 'bok.yaml' of each directory in its 'definition_files'. 
+     * 
+     * The result is kept in a binary snapshot, along with the state of every manifest it came from. 
+     * As long as none of them changed, later loads read the snapshot and don't parse any YAML.
+     */
+    class ManifestLoader {
+    public:
+        /**
+         * Keeps the snapshot in 'snapshotFile'. An empty path always parses the manifests.
+         */
+        explicit ManifestLoader(const std::string &snapshotFile = "");
+
+        Manifest load(const std::string &packageDirectory);
+
+        /**
+         * Whether the last load came from the snapshot.
+         */
+        bool isSnapshotUsed() const {
+            return snapshotUsed;
+        }
+
+    private:
+        Manifest parse(const std::string &packageDirectory, std::vector<std::string> &manifestFiles) const;
+
+        void save(const std::string &packageDirectory, const std::vector<std::string> &manifestFiles, const Manifest &manifest) const;
+
+    private:
+        std::string snapshotFile;
+        bool snapshotUsed = false;
+    };
+
+
+    /**
+     * Creates the build model of 'manifest', whose package lives in 'packageDirectory'. Components 
+     * depending on other components of the same package get linked after them.
+     */
+    bok::Package* createPackage(const std::string &packageDirectory, const Manifest &manifest);
+}
@@ -6,7 +6,7 @@
 
 #include "Version.hpp"
 
-namespace bok {
+namespace bok::input {
 	struct Package {
 		std::string name;
 		std::string description;
@@ -1,12 +1,19 @@
 
 #pragma once 
 
-namespace bok {
+#include <string>
+
+namespace bok::input {
 	struct Version {
-		int major;
-		int minor;
-		int revision;
+		int major = 0;
+		int minor = 0;
+		int revision = 0;
 
         bool operator == (const Version &rhs) const;
+
+        /**
+         * Parses a "<major>[.<minor>[.<revision>]]" version, like "1.70.0".
+         */
+        static Version parse(const std::string &value);
 	};
 }
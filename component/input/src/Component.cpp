@@ -1,16 +1,34 @@
 
-#include "Component.hpp"
+#include <bok/input/Component.hpp>
+
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace bok::input {
+    namespace {
+        std::pair<std::string, std::string> splitQualifier(const std::string &value, const std::string &what) {
+            const std::size_t slash = value.find('/');
+            const std::string name = value.substr(0, slash);
+
+            if (name.empty()) {
+                throw std::runtime_error("Invalid component " + what + " '" + value + "'");
+            }
+
+            return {name, slash == std::string::npos ? "" : value.substr(slash + 1)};
+        }
+    }
+
 
-namespace bok {
     ComponentLanguage::ComponentLanguage(const std::string &value) {
-        // TODO: Add implementation
+        std::tie(name, dialect) = splitQualifier(value, "language");
     }
 
     ComponentLanguage::~ComponentLanguage() {}
 
 
     ComponentType::ComponentType(const std::string &value) {
-        // TODO: Add implementation
+        std::tie(name, kind) = splitQualifier(value, "type");
     }
 
     ComponentType::~ComponentType() {}
@@ -1,11 +1,77 @@
 
-#include "Dependency.hpp"
+#include <bok/input/Dependency.hpp>
+
+#include <stdexcept>
+
+namespace bok::input {
+	namespace {
+		std::string trim(const std::string &value) {
+			const std::size_t begin = value.find_first_not_of(" \t");
+
+			if (begin == std::string::npos) {
+				return "";
+			}
+
+			return value.substr(begin, value.find_last_not_of(" \t") - begin + 1);
+		}
+	}
+
 
-namespace bok {
 	Dependency::Dependency(const std::string &value) {
-		// TODO: Add parsing code, 
-		// Syntax to parse:
-		// - "boost>=1.70.0/[filesystem, system, process, program_options]"
-		// - "jbeder/yaml-cpp"
+		const std::size_t slash = value.find('/');
+		const std::string head = trim(value.substr(0, slash));
+		const std::size_t restriction = head.find_first_of("<>=");
+
+		packageName = trim(head.substr(0, restriction));
+
+		if (packageName.empty()) {
+			throw std::runtime_error("Missing the package name in the dependency '" + value + "'");
+		}
+
+		if (restriction != std::string::npos) {
+			const std::string op = head.substr(restriction, 2);
+			DependencyVersion version;
+
+			if (op == ">=") {
+				version.restriction = DependencyVersion::Restriction::GreaterOrEqual;
+			} else if (op == "<=") {
+				version.restriction = DependencyVersion::Restriction::LesserOrEqual;
+			} else if (op == "==") {
+				version.restriction = DependencyVersion::Restriction::Equal;
+			} else {
+				throw std::runtime_error("Invalid version restriction in the dependency '" + value + "'");
+			}
+
+			version.version = Version::parse(trim(head.substr(restriction + 2)));
+			dependencyVersion = version;
+		}
+
+		if (slash == std::string::npos) {
+			return;
+		}
+
+		std::string components = trim(value.substr(slash + 1));
+
+		if (! components.empty() && components.front() == '[') {
+			if (components.back() != ']') {
+				throw std::runtime_error("Unterminated component list in the dependency '" + value + "'");
+			}
+
+			components = components.substr(1, components.size() - 2);
+		}
+
+		std::size_t begin = 0;
+
+		while (begin <= components.size()) {
+			const std::size_t end = std::min(components.find(',', begin), components.size());
+			const std::string component = trim(components.substr(begin, end - begin));
+
+			if (component.empty()) {
+				throw std::runtime_error("Empty component name in the dependency '" + value + "'");
+			}
+
+			componentNames.push_back(component);
+			begin = end + 1;
+		}
 	}
 }
@@ -0,0 +1,489 @@
+
+#include <bok/input/ManifestLoader.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <yaml-cpp/yaml.h>
+
+#include <bok/core/Component.hpp>
+#include <bok/core/FileState.hpp>
+#include <bok/core/Hash.hpp>
+#include <bok/core/Package.hpp>
+
+namespace bok::input {
+    namespace {
+        constexpr char SNAPSHOT_MAGIC[8] = {'B', 'O', 'K', 'M', 'A', 'N', 'I', 'F'};
+        constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+        const std::string MANIFEST_NAME = "bok.yaml";
+
+        /**
+         * Serializes the manifests into the snapshot payload.
+         */
+        class SnapshotWriter {
+        public:
+            template<typename Value>
+            void write(const Value value) {
+                data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            }
+
+            void write(const std::string &value) {
+                this->write(static_cast<std::uint32_t>(value.size()));
+                data.append(value);
+            }
+
+            void write(const std::vector<std::string> &values) {
+                this->write(static_cast<std::uint32_t>(values.size()));
+
+                for (const std::string &value : values) {
+                    this->write(value);
+                }
+            }
+
+            void write(const Version &version) {
+                this->write(static_cast<std::int32_t>(version.major));
+                this->write(static_cast<std::int32_t>(version.minor));
+                this->write(static_cast<std::int32_t>(version.revision));
+            }
+
+            void write(const Manifest &manifest) {
+                const Package &package = manifest.package;
+
+                this->write(package.name);
+                this->write(package.description);
+                this->write(package.version);
+                this->write(package.license);
+                this->write(package.author);
+                this->write(package.email);
+                this->write(package.definitionFiles);
+
+                this->write(static_cast<std::uint32_t>(manifest.components.size()));
+
+                for (const Component &component : manifest.components) {
+                    this->write(component.name);
+                    this->write(component.description);
+                    this->write(component.path);
+                    this->write(component.type.name);
+                    this->write(component.type.kind);
+
+                    this->write(static_cast<std::uint32_t>(component.languages.size()));
+
+                    for (const ComponentLanguage &language : component.languages) {
+                        this->write(language.name);
+                        this->write(language.dialect);
+                    }
+
+                    this->write(component.sources);
+
+                    this->write(static_cast<std::uint32_t>(component.dependencies.size()));
+
+                    for (const Dependency &dependency : component.dependencies) {
+                        this->write(dependency.packageName);
+                        this->write(dependency.componentNames);
+                        this->write(static_cast<std::uint8_t>(dependency.dependencyVersion.has_value()));
+
+                        if (dependency.dependencyVersion) {
+                            this->write(dependency.dependencyVersion->version);
+                            this->write(static_cast<std::uint8_t>(dependency.dependencyVersion->restriction));
+                        }
+                    }
+                }
+            }
+
+            const std::string& getData() const {
+                return data;
+            }
+
+        private:
+            std::string data;
+        };
+
+
+        /**
+         * Reads back what SnapshotWriter wrote. Running past the end throws.
+         */
+        class SnapshotReader {
+        public:
+            // the least a string or a count takes, to tell counts that can't be right
+            static constexpr std::size_t COUNT_SIZE = sizeof(std::uint32_t);
+            static constexpr std::size_t STRING_SIZE = COUNT_SIZE;
+
+            explicit SnapshotReader(const std::string &data) 
+                : data(data) {}
+
+            template<typename Value>
+            Value read() {
+                Value value;
+                this->readBytes(&value, sizeof(value));
+
+                return value;
+            }
+
+            std::string readString() {
+                const auto size = this->read<std::uint32_t>();
+
+                if (size > data.size() - offset) {
+                    throw std::runtime_error("Truncated manifest snapshot");
+                }
+
+                std::string value = data.substr(offset, size);
+                offset += size;
+
+                return value;
+            }
+
+            /**
+             * Reads the number of elements that follow, each taking at least 'elementSize' bytes. A count 
+             * the rest of the data couldn't hold throws, rather than allocating for it.
+             */
+            std::size_t readCount(const std::size_t elementSize) {
+                const auto count = this->read<std::uint32_t>();
+
+                if (count > (data.size() - offset) / elementSize) {
+                    throw std::runtime_error("Truncated manifest snapshot");
+                }
+
+                return count;
+            }
+
+            std::vector<std::string> readStrings() {
+                std::vector<std::string> values(this->readCount(STRING_SIZE));
+
+                for (std::string &value : values) {
+                    value = this->readString();
+                }
+
+                return values;
+            }
+
+            Version readVersion() {
+                Version version;
+                version.major = this->read<std::int32_t>();
+                version.minor = this->read<std::int32_t>();
+                version.revision = this->read<std::int32_t>();
+
+                return version;
+            }
+
+            Manifest readManifest() {
+                Manifest manifest;
+                Package &package = manifest.package;
+
+                package.name = this->readString();
+                package.description = this->readString();
+                package.version = this->readVersion();
+                package.license = this->readString();
+                package.author = this->readString();
+                package.email = this->readString();
+                package.definitionFiles = this->readStrings();
+
+                manifest.components.resize(this->readCount(5 * STRING_SIZE + 3 * COUNT_SIZE));
+
+                for (Component &component : manifest.components) {
+                    component.name = this->readString();
+                    component.description = this->readString();
+                    component.path = this->readString();
+                    component.type.name = this->readString();
+                    component.type.kind = this->readString();
+
+                    component.languages.resize(this->readCount(2 * STRING_SIZE));
+
+                    for (ComponentLanguage &language : component.languages) {
+                        language.name = this->readString();
+                        language.dialect = this->readString();
+                    }
+
+                    component.sources = this->readStrings();
+                    component.dependencies.resize(this->readCount(STRING_SIZE + COUNT_SIZE + 1));
+
+                    for (Dependency &dependency : component.dependencies) {
+                        dependency.packageName = this->readString();
+                        dependency.componentNames = this->readStrings();
+
+                        if (this->read<std::uint8_t>()) {
+                            DependencyVersion version;
+                            version.version = this->readVersion();
+                            version.restriction = static_cast<DependencyVersion::Restriction>(this->read<std::uint8_t>());
+                            dependency.dependencyVersion = version;
+                        }
+                    }
+                }
+
+                return manifest;
+            }
+
+            bool atEnd() const {
+                return offset == data.size();
+            }
+
+        private:
+            void readBytes(void *value, const std::size_t size) {
+                if (size > data.size() - offset) {
+                    throw std::runtime_error("Truncated manifest snapshot");
+                }
+
+                std::memcpy(value, data.data() + offset, size);
+                offset += size;
+            }
+
+        private:
+            const std::string &data;
+            std::size_t offset = 0;
+        };
+
+
+        std::string readFile(const std::string &path) {
+            std::ifstream is {path, std::ios::binary};
+            std::stringstream content;
+            content << is.rdbuf();
+
+            return content.str();
+        }
+
+
+        std::vector<std::string> readSequence(const YAML::Node &node) {
+            std::vector<std::string> values;
+
+            for (const YAML::Node &item : node) {
+                values.push_back(item.as<std::string>());
+            }
+
+            return values;
+        }
+
+
+        YAML::Node loadYaml(const std::string &path) {
+            try {
+                return YAML::LoadFile(path);
+            } catch (const YAML::Exception &exp) {
+                throw std::runtime_error("Couldn't load the manifest '" + path + "': " + exp.what());
+            }
+        }
+
+
+        Package parsePackage(const std::string &path) {
+            const YAML::Node node = loadYaml(path);
+
+            try {
+                Package package;
+                package.name = node["name"].as<std::string>();
+                package.description = node["description"].as<std::string>("");
+                package.version = Version::parse(node["version"].as<std::string>("0.0.0"));
+                package.license = node["license"].as<std::string>("");
+                package.author = node["author"].as<std::string>("");
+                package.email = node["email"].as<std::string>("");
+                package.definitionFiles = readSequence(node["definition_files"]);
+
+                return package;
+            } catch (const std::exception &exp) {
+                throw std::runtime_error("Invalid package manifest '" + path + "': " + exp.what());
+            }
+        }
+
+
+        Component parseComponent(const std::string &path, const std::string &componentPath) {
+            const YAML::Node node = loadYaml(path);
+
+            try {
+                Component component;
+                component.name = node["name"].as<std::string>();
+                component.description = node["description"].as<std::string>("");
+                component.path = componentPath;
+                component.type = ComponentType{node["type"].as<std::string>()};
+                component.sources = readSequence(node["sources"]);
+
+                for (const std::string &language : readSequence(node["languages"])) {
+                    component.languages.emplace_back(language);
+                }
+
+                for (const std::string &dependency : readSequence(node["dependencies"])) {
+                    component.dependencies.emplace_back(dependency);
+                }
+
+                return component;
+            } catch (const std::exception &exp) {
+                throw std::runtime_error("Invalid component manifest '" + path + "': " + exp.what());
+            }
+        }
+
+
+        /**
+         * Maps a manifest type, like "application/console" or "library/shared", to what the component builds into.
+         */
+        bok::Component::Type toComponentType(const Component &component) {
+            const ComponentType &type = component.type;
+
+            if (type.name == "application") {
+                return bok::Component::Type::Executable;
+            }
+
+            if (type.name == "library") {
+                if (type.kind.empty() || type.kind == "static") {
+                    return bok::Component::Type::StaticLibrary;
+                }
+
+                if (type.kind == "shared" || type.kind == "dynamic") {
+                    return bok::Component::Type::SharedLibrary;
+                }
+            }
+
+            throw std::runtime_error("The component '" + component.name + "' has an unsupported type '" + type.name + (type.kind.empty() ? "" : "/" + type.kind) + "'");
+        }
+    }
+
+
+    ManifestLoader::ManifestLoader(const std::string &snapshotFile) {
+        this->snapshotFile = snapshotFile;
+    }
+
+
+    Manifest ManifestLoader::load(const std::string &packageDirectory) {
+        snapshotUsed = false;
+
+        // header: the package directory, then the state of each manifest the snapshot was made from
+        const std::string snapshot = snapshotFile.empty() ? "" : readFile(snapshotFile);
+
+        if (snapshot.size() > sizeof(SNAPSHOT_MAGIC) && std::memcmp(snapshot.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0) {
+            try {
+                const std::string data = snapshot.substr(sizeof(SNAPSHOT_MAGIC));
+                SnapshotReader reader {data};
+
+                bool current = reader.read<std::uint32_t>() == SNAPSHOT_VERSION && reader.readString() == packageDirectory;
+                bool restated = false;
+                std::vector<std::string> manifestFiles(current ? reader.readCount(SnapshotReader::STRING_SIZE + 3 * sizeof(std::uint64_t)) : 0);
+
+                for (std::string &path : manifestFiles) {
+                    path = reader.readString();
+                    const auto modifiedTime = reader.read<std::int64_t>();
+                    const auto size = reader.read<std::uint64_t>();
+                    const auto contentHash = reader.read<std::uint64_t>();
+
+                    if (! current) {
+                        continue;
+                    }
+
+                    // a manifest whose timestamp changed is still current when its content didn't
+                    const auto state = statFile(path);
+
+                    if (! state || state->size != size) {
+                        current = false;
+                    } else if (state->modifiedTime != modifiedTime) {
+                        const auto hash = hashFile(path);
+                        current = hash && *hash == contentHash;
+                        restated = true;
+                    }
+                }
+
+                if (current) {
+                    Manifest manifest = reader.readManifest();
+
+                    if (reader.atEnd()) {
+                        // so the next load doesn't hash the same manifests again
+                        if (restated) {
+                            this->save(packageDirectory, manifestFiles, manifest);
+                        }
+
+                        snapshotUsed = true;
+                        return manifest;
+                    }
+                }
+            } catch (const std::runtime_error &) {
+                // a damaged snapshot is just parsed again
+            }
+        }
+
+        std::vector<std::string> manifestFiles;
+        Manifest manifest = this->parse(packageDirectory, manifestFiles);
+
+        if (! snapshotFile.empty()) {
+            this->save(packageDirectory, manifestFiles, manifest);
+        }
+
+        return manifest;
+    }
+
+
+    void ManifestLoader::save(const std::string &packageDirectory, const std::vector<std::string> &manifestFiles, const Manifest &manifest) const {
+        SnapshotWriter writer;
+        writer.write(SNAPSHOT_VERSION);
+        writer.write(packageDirectory);
+        writer.write(static_cast<std::uint32_t>(manifestFiles.size()));
+
+        for (const std::string &path : manifestFiles) {
+            const FileState state = scanFile(path).value_or(FileState{});
+
+            writer.write(path);
+            writer.write(state.modifiedTime);
+            writer.write(state.size);
+            writer.write(state.contentHash);
+        }
+
+        writer.write(manifest);
+
+        const std::string temporaryFile = snapshotFile + ".tmp";
+
+        {
+            std::ofstream os {temporaryFile, std::ios::binary | std::ios::trunc};
+            os.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+            os << writer.getData();
+        }
+
+        std::rename(temporaryFile.c_str(), snapshotFile.c_str());
+    }
+
+
+    Manifest ManifestLoader::parse(const std::string &packageDirectory, std::vector<std::string> &manifestFiles) const {
+        const std::filesystem::path root {packageDirectory};
+        const std::string packageManifest = (root / MANIFEST_NAME).lexically_normal().string();
+
+        Manifest manifest;
+        manifest.package = parsePackage(packageManifest);
+        manifestFiles.push_back(packageManifest);
+
+        for (const std::string &definitionFile : manifest.package.definitionFiles) {
+            const std::string componentManifest = (root / definitionFile / MANIFEST_NAME).lexically_normal().string();
+
+            manifest.components.push_back(parseComponent(componentManifest, definitionFile));
+            manifestFiles.push_back(componentManifest);
+        }
+
+        return manifest;
+    }
+
+
+    bok::Package* createPackage(const std::string &packageDirectory, const Manifest &manifest) {
+        auto package = new bok::Package(manifest.package.name, packageDirectory);
+        std::map<std::string, bok::Component*> components;
+
+        for (const Component &component : manifest.components) {
+            components[component.name] = package->addComponent(component.name, component.path, component.sources);
+            components[component.name]->setType(toComponentType(component));
+        }
+
+        for (const Component &component : manifest.components) {
+            for (const Dependency &dependency : component.dependencies) {
+                // dependencies on other packages are left to whoever provides them
+                if (dependency.packageName != manifest.package.name) {
+                    continue;
+                }
+
+                for (const std::string &name : dependency.componentNames) {
+                    const auto it = components.find(name);
+
+                    if (it == components.end()) {
+                        throw std::runtime_error("The component '" + component.name + "' depends on an unknown component '" + name + "'");
+                    }
+
+                    components[component.name]->addDependency(it->second);
+                }
+            }
+        }
+
+        return package;
+    }
+}
@@ -1,6 +1,6 @@
 
-#include "Package.hpp"
+#include <bok/input/Package.hpp>
 
-namespace bok {
+namespace bok::input {
     Package::~Package() {}
 }
@@ -1,10 +1,38 @@
 
-#include <bok/core/input/Version.hpp>
+#include <bok/input/Version.hpp>
 
+#include <stdexcept>
 #include <tuple>
 
-namespace bok {
+namespace bok::input {
     bool Version::operator== (const Version &rhs) const {
         return std::tuple(major, minor, revision) == std::tuple(rhs.major, rhs.minor, rhs.revision);
     }
+
+
+    Version Version::parse(const std::string &value) {
+        Version version;
+        int *parts[] = {&version.major, &version.minor, &version.revision};
+
+        std::size_t part = 0;
+        std::size_t begin = 0;
+
+        while (begin < value.size()) {
+            const std::size_t end = std::min(value.find('.', begin), value.size());
+            const std::string number = value.substr(begin, end - begin);
+
+            if (part == 3 || number.empty() || number.find_first_not_of("0123456789") != std::string::npos) {
+                throw std::runtime_error("Invalid version '" + value + "'");
+            }
+
+            *parts[part++] = std::stoi(number);
+            begin = end + 1;
+        }
+
+        if (part == 0 || value.back() == '.') {
+            throw std::runtime_error("Invalid version '" + value + "'");
+        }
+
+        return version;
+    }
 }